@@ -0,0 +1,133 @@
+#include "async_request_queue.h"
+#include <algorithm>
+#include <iterator>
+#include "process_queries.h"
+
+AsyncRequestQueue::AsyncRequestQueue(const SearchServer &search_server, QueryExecutor &executor,
+                                     AsyncQueryOptions options)
+        : search_server_(search_server), executor_(executor), options_(options) {
+    if (options_.max_queue_size == 0 || options_.max_batch_size == 0) {
+        throw std::invalid_argument("Queue and batch sizes must be positive"s);
+    }
+    dispatcher_ = std::thread([this] {
+        DispatchLoop();
+    });
+}
+
+AsyncRequestQueue::~AsyncRequestQueue() {
+    {
+        std::lock_guard guard(mutex_);
+        is_stopping_ = true;
+    }
+    query_arrived_.notify_one();
+    dispatcher_.join();
+    std::unique_lock lock(mutex_);
+    query_finished_.wait(lock, [this] {
+        return unfinished_count_ == 0;
+    });
+}
+
+std::future<std::vector<Document>> AsyncRequestQueue::SubmitQuery(std::string raw_query, DocumentStatus status) {
+    std::promise<std::vector<Document>> promise;
+    auto result = promise.get_future();
+    {
+        std::lock_guard guard(mutex_);
+        if (waiting_count_ >= options_.max_queue_size) {
+            ++rejected_count_;
+            throw QueryRejectedError("Query queue is full"s);
+        }
+        queue_.push_back({std::move(raw_query), status, std::move(promise)});
+        ++waiting_count_;
+        ++unfinished_count_;
+    }
+    query_arrived_.notify_one();
+    return result;
+}
+
+size_t AsyncRequestQueue::GetQueueSize() const {
+    std::lock_guard guard(mutex_);
+    return waiting_count_;
+}
+
+uint64_t AsyncRequestQueue::GetRejectedCount() const {
+    std::lock_guard guard(mutex_);
+    return rejected_count_;
+}
+
+void AsyncRequestQueue::DispatchLoop() {
+    std::vector<PendingQuery> batch;
+    while (true) {
+        {
+            std::unique_lock lock(mutex_);
+            query_arrived_.wait(lock, [this] {
+                return is_stopping_ || !queue_.empty();
+            });
+            if (queue_.empty()) {
+                return;
+            }
+            if (options_.batch_delay.count() > 0) {
+                query_arrived_.wait_for(lock, options_.batch_delay, [this] {
+                    return is_stopping_ || queue_.size() >= options_.max_batch_size;
+                });
+            }
+            const size_t batch_size = std::min(queue_.size(), options_.max_batch_size);
+            for (size_t i = 0; i < batch_size; ++i) {
+                batch.push_back(std::move(queue_.front()));
+                queue_.pop_front();
+            }
+        }
+        PostBatch(batch);
+        batch.clear();
+    }
+}
+
+void AsyncRequestQueue::PostBatch(std::vector<PendingQuery> &batch) {
+    std::vector<PendingQuery> short_queries;
+    for (auto &query: batch) {
+        if (IsLongQuery(query.raw_query)) {
+            std::vector<PendingQuery> queries;
+            queries.push_back(std::move(query));
+            PostQueries(std::move(queries));
+        } else {
+            short_queries.push_back(std::move(query));
+        }
+    }
+    // A short query costs about as much as handing it to a worker, so the short queries of a batch are run
+    // back to back in at most one task per worker, which reuses the worker's search buffers between them
+    const size_t task_count = std::min(short_queries.size(), executor_.GetWorkerCount());
+    for (size_t task = 0, begin = 0; task < task_count; ++task) {
+        const size_t end = begin + (short_queries.size() - begin) / (task_count - task);
+        PostQueries(std::vector<PendingQuery>(std::make_move_iterator(short_queries.begin() + begin),
+                                              std::make_move_iterator(short_queries.begin() + end)));
+        begin = end;
+    }
+}
+
+void AsyncRequestQueue::PostQueries(std::vector<PendingQuery> queries) {
+    executor_.Post([this, queries = std::move(queries)]() mutable {
+        {
+            std::lock_guard guard(mutex_);
+            waiting_count_ -= queries.size();
+        }
+        for (auto &query: queries) {
+            RunQuery(query);
+        }
+        std::lock_guard guard(mutex_);
+        unfinished_count_ -= queries.size();
+        if (unfinished_count_ == 0) {
+            query_finished_.notify_all();
+        }
+    });
+}
+
+void AsyncRequestQueue::RunQuery(PendingQuery &query) {
+    try {
+        if (IsLongQuery(query.raw_query)) {
+            query.promise.set_value(search_server_.FindTopDocuments(executor_, query.raw_query, query.status));
+        } else {
+            query.promise.set_value(search_server_.FindTopDocuments(query.raw_query, query.status));
+        }
+    } catch (...) {
+        query.promise.set_exception(std::current_exception());
+    }
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "document.h"
+#include "query_executor.h"
+#include "search_server.h"
+
+struct AsyncQueryOptions {
+    // Queries beyond this many waiting ones, submitted but not yet started, are rejected
+    size_t max_queue_size = 1024;
+    // Most queries the dispatcher takes per wake-up; the short ones among them share executor tasks
+    size_t max_batch_size = 64;
+    // How long the first query of a batch waits for others to arrive, trading latency for larger batches
+    std::chrono::microseconds batch_delay{0};
+};
+
+class QueryRejectedError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+// Asynchronous front end of a SearchServer. Submitted queries wait in a bounded queue; a dispatcher
+// thread takes whatever has arrived as a batch and posts it to a QueryExecutor without waiting for it:
+// every long query gets a task of its own and the short ones are split between at most one task per
+// worker. So callers do not hold a thread per query, the server does not oversubscribe the CPU under load
+// and a slow query only occupies one worker.
+// The server must not be modified while queries are pending.
+class AsyncRequestQueue {
+public:
+    AsyncRequestQueue(const SearchServer &search_server, QueryExecutor &executor,
+                      AsyncQueryOptions options = AsyncQueryOptions());
+
+    AsyncRequestQueue(const AsyncRequestQueue &) = delete;
+
+    AsyncRequestQueue &operator=(const AsyncRequestQueue &) = delete;
+
+    // Waits for the queries already submitted
+    ~AsyncRequestQueue();
+
+    // Throws QueryRejectedError if the queue is full. Errors of the query itself are stored in the future.
+    [[nodiscard]] std::future<std::vector<Document>> SubmitQuery(std::string raw_query,
+                                                                 DocumentStatus status = DocumentStatus::ACTUAL);
+
+    // Number of queries submitted and not yet started, a query starts with the task running it
+    [[nodiscard]] size_t GetQueueSize() const;
+
+    [[nodiscard]] uint64_t GetRejectedCount() const;
+
+private:
+    struct PendingQuery {
+        std::string raw_query;
+        DocumentStatus status;
+        std::promise<std::vector<Document>> promise;
+    };
+
+    const SearchServer &search_server_;
+    QueryExecutor &executor_;
+    const AsyncQueryOptions options_;
+    mutable std::mutex mutex_;
+    std::condition_variable query_arrived_;
+    std::condition_variable query_finished_;
+    std::deque<PendingQuery> queue_;
+    // Queries in queue_ or in executor tasks not yet started
+    size_t waiting_count_ = 0;
+    // Queries submitted and not yet finished
+    size_t unfinished_count_ = 0;
+    uint64_t rejected_count_ = 0;
+    bool is_stopping_ = false;
+    std::thread dispatcher_;
+
+    void DispatchLoop();
+
+    void PostBatch(std::vector<PendingQuery> &batch);
+
+    void PostQueries(std::vector<PendingQuery> queries);
+
+    void RunQuery(PendingQuery &query);
+};
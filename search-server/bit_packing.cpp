@@ -0,0 +1,94 @@
+#include "bit_packing.h"
+#include <algorithm>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace {
+    const size_t LANE_COUNT = 4;
+    const size_t VALUES_PER_LANE = PACKED_BLOCK_SIZE / LANE_COUNT;
+
+    uint32_t LowBitMask(uint32_t bit_width) {
+        return bit_width == 32 ? UINT32_MAX : (1u << bit_width) - 1;
+    }
+}
+
+uint32_t RequiredBitWidth(const uint32_t *values, size_t count) {
+    uint32_t accumulated = 0;
+    for (size_t i = 0; i < count; ++i) {
+        accumulated |= values[i];
+    }
+    uint32_t bit_width = 0;
+    while (bit_width < 32 && (accumulated >> bit_width) != 0) {
+        ++bit_width;
+    }
+    return bit_width;
+}
+
+void PackBlock(const uint32_t *values, uint32_t bit_width, uint32_t *words) {
+    std::fill(words, words + PackedWordCount(bit_width), 0);
+    if (bit_width == 0) {
+        return;
+    }
+    for (size_t i = 0; i < PACKED_BLOCK_SIZE; ++i) {
+        const size_t lane = i % LANE_COUNT;
+        const size_t bit = i / LANE_COUNT * bit_width;
+        const size_t word = bit / 32;
+        const uint32_t shift = bit % 32;
+        words[word * LANE_COUNT + lane] |= values[i] << shift;
+        if (shift + bit_width > 32) {
+            words[(word + 1) * LANE_COUNT + lane] |= values[i] >> (32 - shift);
+        }
+    }
+}
+
+#ifdef __SSE2__
+
+void UnpackBlock(const uint32_t *words, uint32_t bit_width, uint32_t *values) {
+    const __m128i mask = _mm_set1_epi32(static_cast<int>(LowBitMask(bit_width)));
+    const auto *input = reinterpret_cast<const __m128i *>(words);
+    auto *output = reinterpret_cast<__m128i *>(values);
+
+    __m128i current = bit_width == 0 ? _mm_setzero_si128() : _mm_loadu_si128(input);
+    uint32_t shift = 0;
+    for (size_t slot = 0; slot < VALUES_PER_LANE; ++slot) {
+        __m128i value = _mm_srl_epi32(current, _mm_cvtsi32_si128(static_cast<int>(shift)));
+        if (shift + bit_width > 32) {
+            current = _mm_loadu_si128(++input);
+            value = _mm_or_si128(value, _mm_sll_epi32(current, _mm_cvtsi32_si128(static_cast<int>(32 - shift))));
+            shift = shift + bit_width - 32;
+        } else {
+            shift += bit_width;
+            if (shift == 32 && slot + 1 < VALUES_PER_LANE) {
+                current = _mm_loadu_si128(++input);
+                shift = 0;
+            }
+        }
+        _mm_storeu_si128(output + slot, _mm_and_si128(value, mask));
+    }
+}
+
+#else
+
+void UnpackBlock(const uint32_t *words, uint32_t bit_width, uint32_t *values) {
+    if (bit_width == 0) {
+        std::fill(values, values + PACKED_BLOCK_SIZE, 0);
+        return;
+    }
+    const uint32_t mask = LowBitMask(bit_width);
+    for (size_t lane = 0; lane < LANE_COUNT; ++lane) {
+        for (size_t slot = 0; slot < VALUES_PER_LANE; ++slot) {
+            const size_t bit = slot * bit_width;
+            const size_t word = bit / 32;
+            const uint32_t shift = bit % 32;
+            uint64_t value = words[word * LANE_COUNT + lane] >> shift;
+            if (shift + bit_width > 32) {
+                value |= static_cast<uint64_t>(words[(word + 1) * LANE_COUNT + lane]) << (32 - shift);
+            }
+            values[slot * LANE_COUNT + lane] = static_cast<uint32_t>(value) & mask;
+        }
+    }
+}
+
+#endif
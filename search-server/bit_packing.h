@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Fixed-width bit packing of blocks of PACKED_BLOCK_SIZE unsigned integers. Values are spread over 4
+// interleaved 32-bit lanes (value i goes to lane i % 4), so a block unpacks with 128-bit SIMD shifts.
+constexpr size_t PACKED_BLOCK_SIZE = 64;
+
+// Number of bits needed to store the largest of the values
+uint32_t RequiredBitWidth(const uint32_t *values, size_t count);
+
+// Number of 32-bit words a packed block of the given bit width occupies
+constexpr size_t PackedWordCount(uint32_t bit_width) {
+    return 4 * ((PACKED_BLOCK_SIZE / 4 * bit_width + 31) / 32);
+}
+
+// Packs PACKED_BLOCK_SIZE values into PackedWordCount(bit_width) words
+void PackBlock(const uint32_t *values, uint32_t bit_width, uint32_t *words);
+
+// Unpacks PACKED_BLOCK_SIZE values, SSE2 accelerated where available
+void UnpackBlock(const uint32_t *words, uint32_t bit_width, uint32_t *values);
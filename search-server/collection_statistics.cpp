@@ -0,0 +1,34 @@
+#include "collection_statistics.h"
+
+void CollectionStatistics::AddDocument(const WordFrequencies &word_freqs) {
+    for (auto it = word_freqs.begin(); it != word_freqs.end(); ++it) {
+        const uint32_t term_id = terms_.Intern((*it).first);
+        if (term_id == document_freqs_.size()) {
+            document_freqs_.push_back(0);
+            term_index_.Add(terms_, term_id);
+        }
+        ++document_freqs_[term_id];
+        word_count_ += it.GetCount();
+    }
+    ++document_count_;
+}
+
+void CollectionStatistics::RemoveDocument(const WordFrequencies &word_freqs) {
+    for (auto it = word_freqs.begin(); it != word_freqs.end(); ++it) {
+        --document_freqs_[terms_.Find((*it).first)];
+        word_count_ -= it.GetCount();
+    }
+    --document_count_;
+}
+
+size_t CollectionStatistics::GetDocumentFrequency(std::string_view word) const {
+    const uint32_t term_id = terms_.Find(word);
+    return term_id == TermDictionary::NO_TERM ? 0 : document_freqs_[term_id];
+}
+
+void CollectionStatistics::ExpandWildcard(std::string_view pattern, size_t max_word_count,
+                                          std::vector<std::string_view> &words) const {
+    term_index_.ExpandWildcard(terms_, pattern, max_word_count, [this](uint32_t term_id) {
+        return document_freqs_[term_id];
+    }, words);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include "forward_index.h"
+#include "term_dictionary.h"
+#include "term_index.h"
+
+// Document frequencies of words over a collection split between several search servers
+class CollectionStatistics {
+public:
+    // Takes the word frequencies of an added or removed document
+    void AddDocument(const WordFrequencies &word_freqs);
+
+    void RemoveDocument(const WordFrequencies &word_freqs);
+
+    [[nodiscard]] size_t GetDocumentCount() const {
+        return document_count_;
+    }
+
+    // Total number of words in the documents, stop words excluded
+    [[nodiscard]] uint64_t GetWordCount() const {
+        return word_count_;
+    }
+
+    // Number of documents containing the word
+    [[nodiscard]] size_t GetDocumentFrequency(std::string_view word) const;
+
+    // Appends the words of the collection matching the wildcard pattern, at most max_word_count most frequent
+    // ones; the views are invalidated by the next AddDocument
+    void ExpandWildcard(std::string_view pattern, size_t max_word_count, std::vector<std::string_view> &words) const;
+
+private:
+    TermDictionary terms_;
+    TermIndex term_index_;
+    std::vector<uint32_t> document_freqs_;
+    size_t document_count_ = 0;
+    uint64_t word_count_ = 0;
+};
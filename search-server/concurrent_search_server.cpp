@@ -0,0 +1,96 @@
+#include "concurrent_search_server.h"
+
+namespace {
+    std::atomic<size_t> next_reader_stripe_index = 0;
+    thread_local const size_t reader_stripe_index = next_reader_stripe_index.fetch_add(1);
+}
+
+ConcurrentSearchServer::ConcurrentSearchServer(const std::string &stop_words_text)
+        : ConcurrentSearchServer(SplitIntoWords(stop_words_text)) {
+}
+
+int ConcurrentSearchServer::GetDocumentCount() const {
+    return Read([](const SearchServer &server) {
+        return server.GetDocumentCount();
+    });
+}
+
+void ConcurrentSearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status,
+                                         const std::vector<int> &ratings) {
+    Write([&](SearchServer &server) {
+        server.AddDocument(document_id, document, status, ratings);
+    });
+}
+
+void ConcurrentSearchServer::AddDocuments(const std::vector<DocumentInput> &documents) {
+    Write([&](SearchServer &server) {
+        server.AddDocuments(documents);
+    });
+}
+
+void ConcurrentSearchServer::RemoveDocument(int document_id) {
+    Write([&](SearchServer &server) {
+        server.RemoveDocument(document_id);
+    });
+}
+
+void ConcurrentSearchServer::RemoveDocuments(const std::vector<int> &document_ids) {
+    Write([&](SearchServer &server) {
+        server.RemoveDocuments(document_ids);
+    });
+}
+
+void ConcurrentSearchServer::EnablePositionalIndex() {
+    Write([](SearchServer &server) {
+        server.EnablePositionalIndex();
+    });
+}
+
+void ConcurrentSearchServer::WaitForReaders(const Version &version) {
+    const auto has_readers = [&version] {
+        for (const auto &stripe: version.reader_stripes) {
+            if (stripe.reader_count.load() != 0) {
+                return true;
+            }
+        }
+        return false;
+    };
+    // The flag is raised before the counters are checked and a leaving reader lowers its counter before it
+    // checks the flag, so either the writer sees the reader gone or the reader sees the writer waiting
+    version.is_writer_waiting.store(true);
+    {
+        std::unique_lock lock(readers_left_mutex_);
+        readers_left_.wait(lock, [&has_readers] {
+            return !has_readers();
+        });
+    }
+    version.is_writer_waiting.store(false);
+}
+
+ConcurrentSearchServer::VersionPin::VersionPin(const ConcurrentSearchServer &owner)
+        : owner_(owner) {
+    // A reader that registers on a copy which is no longer published retries, so a writer that saw no
+    // readers on that copy can safely change it
+    while (true) {
+        version_ = &owner.versions_[owner.published_.load()];
+        stripe_ = &version_->reader_stripes[reader_stripe_index % READER_STRIPE_COUNT];
+        stripe_->reader_count.fetch_add(1);
+        if (version_ == &owner.versions_[owner.published_.load()]) {
+            return;
+        }
+        Leave();
+    }
+}
+
+ConcurrentSearchServer::VersionPin::~VersionPin() {
+    Leave();
+}
+
+void ConcurrentSearchServer::VersionPin::Leave() {
+    stripe_->reader_count.fetch_sub(1);
+    if (version_->is_writer_waiting.load()) {
+        // Taking the lock orders the notification after the writer started waiting
+        std::lock_guard guard(owner_.readers_left_mutex_);
+        owner_.readers_left_.notify_one();
+    }
+}
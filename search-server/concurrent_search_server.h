@@ -0,0 +1,136 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "search_server.h"
+
+// SearchServer that can be queried while it is being modified. It keeps two copies of the index: readers
+// pin the published copy without locking, a writer changes the other copy and publishes it atomically,
+// then sleeps until readers have left the old copy and repeats the change on it. Writers are serialized,
+// and the index takes twice the memory. Every thread registers its readers in its own stripe of counters,
+// so readers on different threads do not share a cache line.
+class ConcurrentSearchServer {
+public:
+    template<typename StringContainer>
+    explicit ConcurrentSearchServer(const StringContainer &stop_words);
+
+    explicit ConcurrentSearchServer(const std::string &stop_words_text);
+
+    // Calls reader with a version of the index that does not change until reader returns
+    template<typename Reader>
+    auto Read(Reader reader) const;
+
+    template<typename Scorer = scoring::TfIdf, typename... Args>
+    [[nodiscard]] std::vector<Document> FindTopDocuments(Args &&... args) const {
+        return Read([&](const SearchServer &server) {
+            return server.FindTopDocuments<Scorer>(std::forward<Args>(args)...);
+        });
+    }
+
+    // Words are copied while the version is pinned, since words matched by a wildcard view the index
+    template<typename... Args>
+    [[nodiscard]] std::tuple<std::vector<std::string>, DocumentStatus> MatchDocument(Args &&... args) const {
+        return Read([&](const SearchServer &server) {
+            const auto [words, status] = server.MatchDocument(std::forward<Args>(args)...);
+            return std::tuple(std::vector<std::string>(words.begin(), words.end()), status);
+        });
+    }
+
+    [[nodiscard]] int GetDocumentCount() const;
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status,
+                     const std::vector<int> &ratings);
+
+    void AddDocuments(const std::vector<DocumentInput> &documents);
+
+    void RemoveDocument(int document_id);
+
+    void RemoveDocuments(const std::vector<int> &document_ids);
+
+    void EnablePositionalIndex();
+
+private:
+    static constexpr size_t READER_STRIPE_COUNT = 8;
+
+    struct alignas(64) ReaderStripe {
+        std::atomic<uint64_t> reader_count = 0;
+    };
+
+    struct Version {
+        SearchServer server;
+        mutable std::array<ReaderStripe, READER_STRIPE_COUNT> reader_stripes;
+        // Set while a writer waits for the readers to leave, so the last one to leave wakes it
+        mutable std::atomic<bool> is_writer_waiting = false;
+
+        template<typename StringContainer>
+        explicit Version(const StringContainer &stop_words)
+                : server(stop_words) {
+        }
+    };
+
+    class VersionPin {
+    public:
+        explicit VersionPin(const ConcurrentSearchServer &owner);
+
+        VersionPin(const VersionPin &) = delete;
+
+        VersionPin &operator=(const VersionPin &) = delete;
+
+        ~VersionPin();
+
+        [[nodiscard]] const SearchServer &GetServer() const {
+            return version_->server;
+        }
+
+    private:
+        const ConcurrentSearchServer &owner_;
+        const Version *version_;
+        ReaderStripe *stripe_;
+
+        void Leave();
+    };
+
+    Version versions_[2];
+    std::atomic<size_t> published_ = 0;
+    std::mutex write_mutex_;
+    mutable std::mutex readers_left_mutex_;
+    mutable std::condition_variable readers_left_;
+
+    void WaitForReaders(const Version &version);
+
+    // Applies writer to both copies; copies are changed by the same calls, so they stay identical
+    template<typename Writer>
+    void Write(Writer writer);
+};
+
+template<typename StringContainer>
+ConcurrentSearchServer::ConcurrentSearchServer(const StringContainer &stop_words)
+        : versions_{Version(stop_words), Version(stop_words)} {
+}
+
+template<typename Reader>
+auto ConcurrentSearchServer::Read(Reader reader) const {
+    const VersionPin pin(*this);
+    return reader(pin.GetServer());
+}
+
+template<typename Writer>
+void ConcurrentSearchServer::Write(Writer writer) {
+    std::lock_guard guard(write_mutex_);
+    const size_t published = published_.load();
+    // Nobody reads the unpublished copy: the previous write waited for its readers to leave
+    auto &next = versions_[1 - published];
+    writer(next.server);
+    published_.store(1 - published);
+
+    auto &previous = versions_[published];
+    WaitForReaders(previous);
+    writer(previous.server);
+}
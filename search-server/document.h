@@ -1,5 +1,7 @@
 #pragma once
 #include <iosfwd>
+#include <string_view>
+#include <vector>
 
 struct Document{
     Document();
@@ -18,4 +20,12 @@ enum class DocumentStatus {
     REMOVED,
 };
 
+// Input record of SearchServer::AddDocuments
+struct DocumentInput {
+    int id = 0;
+    std::string_view text;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    std::vector<int> ratings;
+};
+
 std::ostream &operator<<(std::ostream &out, const Document &doc);
\ No newline at end of file
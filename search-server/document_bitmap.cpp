@@ -0,0 +1,162 @@
+#include "document_bitmap.h"
+#include <algorithm>
+#include <bitset>
+#include <iterator>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace {
+    constexpr size_t CHUNK_WORD_COUNT = (1u << 16) / 64;
+
+    void SetBit(uint64_t *words, uint16_t value) {
+        words[value / 64] |= uint64_t{1} << (value % 64);
+    }
+
+    // words |= other over the words of a chunk
+    void OrWords(uint64_t *words, const uint64_t *other) {
+#ifdef __SSE2__
+        for (size_t i = 0; i < CHUNK_WORD_COUNT; i += 2) {
+            auto *output = reinterpret_cast<__m128i *>(words + i);
+            const auto *input = reinterpret_cast<const __m128i *>(other + i);
+            _mm_storeu_si128(output, _mm_or_si128(_mm_loadu_si128(output), _mm_loadu_si128(input)));
+        }
+#else
+        for (size_t i = 0; i < CHUNK_WORD_COUNT; ++i) {
+            words[i] |= other[i];
+        }
+#endif
+    }
+
+    uint32_t CountBits(const uint64_t *words) {
+        uint32_t count = 0;
+        for (size_t i = 0; i < CHUNK_WORD_COUNT; ++i) {
+            count += static_cast<uint32_t>(std::bitset<64>(words[i]).count());
+        }
+        return count;
+    }
+}
+
+void DocumentBitmap::Cursor::Seek(uint32_t ordinal) {
+    const auto &chunks = bitmap_->chunks_;
+    bitset_end_ = 0;
+    for (uint32_t key = ordinal >> 16; key < chunks.size(); ++key) {
+        const Chunk &chunk = chunks[key];
+        if (chunk.size > ARRAY_MAX_SIZE) {
+            next_ = key << 16;
+            bitset_end_ = (uint64_t{key} + 1) << 16;
+            words_ = bitmap_->words_.data() + chunk.offset;
+            return;
+        }
+        const uint16_t *values = bitmap_->values_.data() + chunk.offset;
+        const uint16_t low = key == ordinal >> 16 ? static_cast<uint16_t>(ordinal) : 0;
+        const uint16_t *value = std::lower_bound(values, values + chunk.size, low);
+        if (value != values + chunk.size) {
+            next_ = key << 16 | *value;
+            return;
+        }
+    }
+    next_ = UINT32_MAX;
+}
+
+void DocumentBitmap::Add(uint32_t ordinal) {
+    auto &chunks = chunks_.Mutable();
+    const uint32_t key = ordinal >> 16;
+    while (chunks.size() <= key) {
+        chunks.push_back({static_cast<uint32_t>(values_.size()), 0});
+    }
+    Chunk &chunk = chunks.back();
+    if (chunk.size == ARRAY_MAX_SIZE) {
+        ConvertLastChunkToBitset();
+    }
+    if (chunk.size < ARRAY_MAX_SIZE) {
+        values_.Mutable().push_back(static_cast<uint16_t>(ordinal));
+    } else {
+        SetBit(words_.Mutable().data() + chunk.offset, static_cast<uint16_t>(ordinal));
+    }
+    ++chunk.size;
+}
+
+DocumentBitmap DocumentBitmap::Or(const DocumentBitmap &lhs, const DocumentBitmap &rhs) {
+    DocumentBitmap result;
+    auto &chunks = result.chunks_.Mutable();
+    auto &values = result.values_.Mutable();
+    auto &words = result.words_.Mutable();
+    const size_t chunk_count = std::max(lhs.chunks_.size(), rhs.chunks_.size());
+    for (size_t key = 0; key < chunk_count; ++key) {
+        const Chunk empty_chunk{0, 0};
+        const Chunk &left = key < lhs.chunks_.size() ? lhs.chunks_[key] : empty_chunk;
+        const Chunk &right = key < rhs.chunks_.size() ? rhs.chunks_[key] : empty_chunk;
+        const bool is_left_bitset = left.size > ARRAY_MAX_SIZE;
+        const bool is_right_bitset = right.size > ARRAY_MAX_SIZE;
+
+        if (!is_left_bitset && !is_right_bitset) {
+            const uint16_t *left_values = lhs.values_.data() + left.offset;
+            const uint16_t *right_values = rhs.values_.data() + right.offset;
+            const auto offset = static_cast<uint32_t>(values.size());
+            std::set_union(left_values, left_values + left.size, right_values, right_values + right.size,
+                           std::back_inserter(values));
+            chunks.push_back({offset, static_cast<uint32_t>(values.size() - offset)});
+            if (chunks.back().size > ARRAY_MAX_SIZE) {
+                result.ConvertLastChunkToBitset();
+            }
+            continue;
+        }
+
+        // The union of a bitset with anything is a bitset: start from one and add the other
+        const auto offset = static_cast<uint32_t>(words.size());
+        const DocumentBitmap &bitset_owner = is_left_bitset ? lhs : rhs;
+        const Chunk &bitset = is_left_bitset ? left : right;
+        const DocumentBitmap &other_owner = is_left_bitset ? rhs : lhs;
+        const Chunk &other = is_left_bitset ? right : left;
+        const uint64_t *bitset_words = bitset_owner.words_.data() + bitset.offset;
+        words.insert(words.end(), bitset_words, bitset_words + CHUNK_WORD_COUNT);
+        if (other.size > ARRAY_MAX_SIZE) {
+            OrWords(words.data() + offset, other_owner.words_.data() + other.offset);
+        } else {
+            const uint16_t *other_values = other_owner.values_.data() + other.offset;
+            for (uint32_t i = 0; i < other.size; ++i) {
+                SetBit(words.data() + offset, other_values[i]);
+            }
+        }
+        chunks.push_back({offset, CountBits(words.data() + offset)});
+    }
+    return result;
+}
+
+void DocumentBitmap::Save(SnapshotWriter &writer) const {
+    writer.WriteArray(chunks_.data(), chunks_.size());
+    writer.WriteArray(values_.data(), values_.size());
+    writer.WriteArray(words_.data(), words_.size());
+}
+
+DocumentBitmap DocumentBitmap::Load(SnapshotReader &reader) {
+    DocumentBitmap bitmap;
+    bitmap.chunks_ = reader.ReadArray<Chunk>();
+    bitmap.values_ = reader.ReadArray<uint16_t>();
+    bitmap.words_ = reader.ReadArray<uint64_t>();
+    for (const auto &chunk: bitmap.chunks_) {
+        const bool is_valid = chunk.size > ARRAY_MAX_SIZE
+                              ? chunk.size <= (1u << 16) &&
+                                chunk.offset + uint64_t{CHUNK_WORD_COUNT} <= bitmap.words_.size()
+                              : chunk.offset + uint64_t{chunk.size} <= bitmap.values_.size();
+        if (!is_valid) {
+            SnapshotReader::ThrowCorrupted();
+        }
+    }
+    return bitmap;
+}
+
+void DocumentBitmap::ConvertLastChunkToBitset() {
+    auto &values = values_.Mutable();
+    auto &words = words_.Mutable();
+    Chunk &chunk = chunks_.Mutable().back();
+    const auto offset = static_cast<uint32_t>(words.size());
+    words.resize(words.size() + CHUNK_WORD_COUNT);
+    for (size_t i = chunk.offset; i < values.size(); ++i) {
+        SetBit(words.data() + offset, values[i]);
+    }
+    values.resize(chunk.offset);
+    chunk.offset = offset;
+}
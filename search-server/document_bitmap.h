@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include "mapped_array.h"
+#include "snapshot.h"
+
+// Compressed set of document ordinals in the manner of Roaring bitmaps. Ordinals are split into chunks of 2^16
+// by their high bits; a chunk of up to ARRAY_MAX_SIZE ordinals is a sorted array of their low bits, a denser one
+// is a bitset. Ordinals are dense, so chunks are indexed directly by the high bits.
+class DocumentBitmap {
+public:
+    static constexpr uint32_t ARRAY_MAX_SIZE = 4096;
+
+    // Membership test for ordinals asked in non-decreasing order, such as those of a posting list. In array
+    // chunks the cursor remembers the first member after the last asked ordinal, so asking about any ordinal
+    // before it is a single comparison; bitset chunks are tested directly.
+    class Cursor {
+    public:
+        explicit Cursor(const DocumentBitmap &bitmap)
+                : bitmap_(&bitmap) {
+        }
+
+        [[nodiscard]] bool Contains(uint32_t ordinal) {
+            if (ordinal < next_) {
+                return false;
+            }
+            if (ordinal >= bitset_end_) {
+                Seek(ordinal);
+                if (ordinal < next_) {
+                    return false;
+                }
+            }
+            if (ordinal < bitset_end_) {
+                const uint32_t bit = ordinal - next_;
+                return (words_[bit / 64] >> (bit % 64)) & 1;
+            }
+            return ordinal == next_;
+        }
+
+    private:
+        const DocumentBitmap *bitmap_;
+        // No member is before it. Inside a bitset chunk it is the start of the chunk and bitset_end_ its end,
+        // otherwise the first member not before the last asked ordinal, UINT32_MAX past the last member.
+        uint32_t next_ = 0;
+        uint64_t bitset_end_ = 0;
+        const uint64_t *words_ = nullptr;
+
+        // Moves to the first chunk that is a bitset or has a member not less than the ordinal
+        void Seek(uint32_t ordinal);
+    };
+
+    // Ordinals are added in increasing order
+    void Add(uint32_t ordinal);
+
+    [[nodiscard]] bool empty() const {
+        return chunks_.empty();
+    }
+
+    // Union of the sets; bitset chunks are merged word by word, SSE2 accelerated where available
+    static DocumentBitmap Or(const DocumentBitmap &lhs, const DocumentBitmap &rhs);
+
+    void Save(SnapshotWriter &writer) const;
+
+    // The bitmap refers to the mapped snapshot until it is modified
+    static DocumentBitmap Load(SnapshotReader &reader);
+
+private:
+    // Ordinals of an array chunk start at offset in values_, the words of a bitset chunk at offset in words_
+    struct Chunk {
+        uint32_t offset;
+        uint32_t size;
+    };
+
+    MappedArray<Chunk> chunks_;
+    MappedArray<uint16_t> values_;
+    MappedArray<uint64_t> words_;
+
+    // Replaces the array of the last chunk, which has to end values_, with a bitset
+    void ConvertLastChunkToBitset();
+};
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include "term_dictionary.h"
+
+// Entry of the forward index: a term of a document and the number of its occurrences.
+// The terms of every document are stored contiguously, sorted by id.
+struct DocumentTerm {
+    uint32_t term_id;
+    uint32_t count;
+};
+
+// Non-owning view of the terms of a document in term id order. Iterates over words or, with Value being
+// std::pair<std::string_view, double>, over (word, term frequency) pairs. Any change of the server
+// invalidates the view.
+template<typename Value>
+class DocumentTermsView {
+public:
+    class Iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Value;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = Value;
+
+        Iterator(const TermDictionary *dictionary, const DocumentTerm *term, double inv_word_count)
+                : dictionary_(dictionary), term_(term), inv_word_count_(inv_word_count) {
+        }
+
+        Value operator*() const {
+            const std::string_view word = dictionary_->GetTerm(term_->term_id);
+            if constexpr (std::is_same_v<Value, std::string_view>) {
+                return word;
+            } else {
+                return {word, term_->count * inv_word_count_};
+            }
+        }
+
+        [[nodiscard]] uint32_t GetTermId() const {
+            return term_->term_id;
+        }
+
+        // Occurrences of the word in the document
+        [[nodiscard]] uint32_t GetCount() const {
+            return term_->count;
+        }
+
+        Iterator &operator++() {
+            ++term_;
+            return *this;
+        }
+
+        Iterator operator++(int) {
+            Iterator old = *this;
+            ++term_;
+            return old;
+        }
+
+        bool operator==(const Iterator &other) const {
+            return term_ == other.term_;
+        }
+
+        bool operator!=(const Iterator &other) const {
+            return term_ != other.term_;
+        }
+
+    private:
+        const TermDictionary *dictionary_;
+        const DocumentTerm *term_;
+        double inv_word_count_;
+    };
+
+    DocumentTermsView() = default;
+
+    DocumentTermsView(const TermDictionary &dictionary, const DocumentTerm *terms, size_t size,
+                      double inv_word_count)
+            : dictionary_(&dictionary), terms_(terms), size_(size), inv_word_count_(inv_word_count) {
+    }
+
+    [[nodiscard]] Iterator begin() const {
+        return {dictionary_, terms_, inv_word_count_};
+    }
+
+    [[nodiscard]] Iterator end() const {
+        return {dictionary_, terms_ + size_, inv_word_count_};
+    }
+
+    [[nodiscard]] size_t size() const {
+        return size_;
+    }
+
+    [[nodiscard]] bool empty() const {
+        return size_ == 0;
+    }
+
+private:
+    const TermDictionary *dictionary_ = nullptr;
+    const DocumentTerm *terms_ = nullptr;
+    size_t size_ = 0;
+    double inv_word_count_ = 0.0;
+};
+
+using WordFrequencies = DocumentTermsView<std::pair<std::string_view, double>>;
+
+using DocumentWords = DocumentTermsView<std::string_view>;
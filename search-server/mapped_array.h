@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Array that either owns its elements or views read-only elements of a memory-mapped snapshot.
+// Viewed elements are copied into owned storage on the first mutable access.
+template<typename T>
+class MappedArray {
+public:
+    MappedArray() = default;
+
+    MappedArray(const T *data, size_t size)
+            : view_data_(data), view_size_(size), is_view_(true) {
+    }
+
+    [[nodiscard]] const T *data() const {
+        return is_view_ ? view_data_ : owned_.data();
+    }
+
+    [[nodiscard]] size_t size() const {
+        return is_view_ ? view_size_ : owned_.size();
+    }
+
+    [[nodiscard]] bool empty() const {
+        return size() == 0;
+    }
+
+    [[nodiscard]] const T *begin() const {
+        return data();
+    }
+
+    [[nodiscard]] const T *end() const {
+        return data() + size();
+    }
+
+    const T &operator[](size_t index) const {
+        return data()[index];
+    }
+
+    [[nodiscard]] const T &back() const {
+        return data()[size() - 1];
+    }
+
+    std::vector<T> &Mutable() {
+        if (is_view_) {
+            owned_.assign(view_data_, view_data_ + view_size_);
+            is_view_ = false;
+        }
+        return owned_;
+    }
+
+private:
+    std::vector<T> owned_;
+    const T *view_data_ = nullptr;
+    size_t view_size_ = 0;
+    bool is_view_ = false;
+};
@@ -0,0 +1,238 @@
+#include "posting_list.h"
+#include <algorithm>
+
+namespace {
+    void AppendVarint(std::vector<uint8_t> &bytes, uint32_t value) {
+        while (value >= 0x80) {
+            bytes.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        bytes.push_back(static_cast<uint8_t>(value));
+    }
+
+    // Never reads past end, so a damaged snapshot cannot make it leave the mapped data
+    uint32_t ReadVarint(const uint8_t *&bytes, const uint8_t *end) {
+        uint32_t value = 0;
+        for (uint32_t shift = 0; bytes != end && shift < 32; shift += 7) {
+            const uint8_t byte = *bytes++;
+            value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+            if (byte < 0x80) {
+                break;
+            }
+        }
+        return value;
+    }
+}
+
+void PostingList::Add(uint32_t document_ordinal, uint32_t count, double term_freq, const uint32_t *positions) {
+    auto &blocks = blocks_.Mutable();
+    auto &tail_ordinals = tail_ordinals_.Mutable();
+    auto &tail_counts = tail_counts_.Mutable();
+    if (!HasTail()) {
+        blocks.push_back({document_ordinal, document_ordinal, 0.0, TAIL_OFFSET, 0, 0, 0});
+        if (positions != nullptr) {
+            block_position_offsets_.Mutable().push_back(static_cast<uint32_t>(positions_.size()));
+        }
+    }
+    if (positions != nullptr) {
+        auto &encoded = positions_.Mutable();
+        for (uint32_t i = 0, previous = 0; i < count; ++i) {
+            AppendVarint(encoded, positions[i] - previous);
+            previous = positions[i];
+        }
+    }
+    tail_ordinals.push_back(document_ordinal);
+    tail_counts.push_back(count);
+    ++size_;
+
+    auto &tail = blocks.back();
+    tail.last_ordinal = document_ordinal;
+    tail.max_term_freq = std::max(tail.max_term_freq, term_freq);
+    tail.size = static_cast<uint8_t>(tail_ordinals.size());
+    max_term_freq_ = std::max(max_term_freq_, term_freq);
+
+    if (tail_ordinals.size() == BLOCK_SIZE) {
+        EncodeBlock(tail, tail_ordinals.data(), tail_counts.data());
+        tail_ordinals.clear();
+        tail_counts.clear();
+    }
+
+    if (size_ > BITMAP_MIN_SIZE) {
+        bitmap_.Add(document_ordinal);
+    } else if (size_ == BITMAP_MIN_SIZE) {
+        for (PostingCursor cursor(*this); !cursor.IsEnd(); cursor.Next()) {
+            bitmap_.Add(cursor.GetOrdinal());
+        }
+    }
+}
+
+size_t PostingList::DecodeBlock(size_t block, uint32_t *ordinals, uint32_t *counts) const {
+    const auto &entry = blocks_[block];
+    if (entry.offset == TAIL_OFFSET) {
+        std::copy(tail_ordinals_.begin(), tail_ordinals_.end(), ordinals);
+        std::copy(tail_counts_.begin(), tail_counts_.end(), counts);
+        return tail_ordinals_.size();
+    }
+
+    const uint32_t *words = packed_words_.data() + entry.offset;
+    UnpackBlock(words, entry.gap_bits, ordinals);
+    UnpackBlock(words + PackedWordCount(entry.gap_bits), entry.count_bits, counts);
+    // The bounds of the block were checked at load, so keeping the ordinals inside them keeps a damaged
+    // snapshot from sending a cursor out of the block
+    uint64_t ordinal = entry.first_ordinal;
+    for (size_t i = 0; i < entry.size; ++i) {
+        ordinal += ordinals[i];
+        ordinals[i] = static_cast<uint32_t>(std::min<uint64_t>(ordinal, entry.last_ordinal));
+    }
+    ordinals[entry.size - 1] = entry.last_ordinal;
+    return entry.size;
+}
+
+void PostingList::Save(SnapshotWriter &writer) const {
+    writer.WriteValue<uint64_t>(size_);
+    writer.WriteValue<uint64_t>(removed_count_);
+    writer.WriteValue(max_term_freq_);
+    writer.WriteArray(blocks_.data(), blocks_.size());
+    writer.WriteArray(packed_words_.data(), packed_words_.size());
+    writer.WriteArray(tail_ordinals_.data(), tail_ordinals_.size());
+    writer.WriteArray(tail_counts_.data(), tail_counts_.size());
+    writer.WriteArray(positions_.data(), positions_.size());
+    writer.WriteArray(block_position_offsets_.data(), block_position_offsets_.size());
+    bitmap_.Save(writer);
+}
+
+PostingList PostingList::Load(SnapshotReader &reader, size_t ordinal_count) {
+    PostingList postings;
+    postings.size_ = reader.ReadValue<uint64_t>();
+    postings.removed_count_ = reader.ReadValue<uint64_t>();
+    postings.max_term_freq_ = reader.ReadValue<double>();
+    postings.blocks_ = reader.ReadArray<PostingBlock>();
+    postings.packed_words_ = reader.ReadArray<uint32_t>();
+    postings.tail_ordinals_ = reader.ReadArray<uint32_t>();
+    postings.tail_counts_ = reader.ReadArray<uint32_t>();
+    postings.positions_ = reader.ReadArray<uint8_t>();
+    postings.block_position_offsets_ = reader.ReadArray<uint32_t>();
+    postings.bitmap_ = DocumentBitmap::Load(reader);
+
+    const auto &tail_ordinals = postings.tail_ordinals_;
+    for (const auto &block: postings.blocks_) {
+        // Every posting of a block lies between its first and last ordinal
+        if (block.size == 0 || block.first_ordinal > block.last_ordinal || block.last_ordinal >= ordinal_count) {
+            SnapshotReader::ThrowCorrupted();
+        }
+        const bool is_valid = block.offset == TAIL_OFFSET
+                              ? block.size == tail_ordinals.size() && block.size < BLOCK_SIZE &&
+                                tail_ordinals[0] == block.first_ordinal && tail_ordinals.back() == block.last_ordinal &&
+                                std::is_sorted(tail_ordinals.begin(), tail_ordinals.end())
+                              : block.size <= BLOCK_SIZE && block.gap_bits <= 32 && block.count_bits <= 32 &&
+                                block.offset + PackedWordCount(block.gap_bits) + PackedWordCount(block.count_bits) <=
+                                postings.packed_words_.size();
+        if (!is_valid) {
+            SnapshotReader::ThrowCorrupted();
+        }
+    }
+    if (postings.tail_counts_.size() != tail_ordinals.size() || postings.HasTail() == tail_ordinals.empty() ||
+        postings.removed_count_ > postings.size_) {
+        SnapshotReader::ThrowCorrupted();
+    }
+    // Decoding stops at the end of the positions, so checking the offsets is enough to stay inside them
+    if (postings.HasPositions()) {
+        if (postings.block_position_offsets_.size() != postings.blocks_.size()) {
+            SnapshotReader::ThrowCorrupted();
+        }
+        for (const uint32_t offset: postings.block_position_offsets_) {
+            if (offset > postings.positions_.size()) {
+                SnapshotReader::ThrowCorrupted();
+            }
+        }
+    } else if (!postings.positions_.empty()) {
+        SnapshotReader::ThrowCorrupted();
+    }
+    return postings;
+}
+
+void PostingList::EncodeBlock(PostingBlock &block, const uint32_t *ordinals, const uint32_t *counts) {
+    uint32_t gaps[BLOCK_SIZE] = {};
+    for (size_t i = 1; i < BLOCK_SIZE; ++i) {
+        gaps[i] = ordinals[i] - ordinals[i - 1];
+    }
+
+    auto &packed_words = packed_words_.Mutable();
+    const uint32_t gap_bits = RequiredBitWidth(gaps, BLOCK_SIZE);
+    const uint32_t count_bits = RequiredBitWidth(counts, BLOCK_SIZE);
+    block.offset = static_cast<uint32_t>(packed_words.size());
+    block.gap_bits = static_cast<uint8_t>(gap_bits);
+    block.count_bits = static_cast<uint8_t>(count_bits);
+    packed_words.resize(packed_words.size() + PackedWordCount(gap_bits) + PackedWordCount(count_bits));
+    PackBlock(gaps, gap_bits, packed_words.data() + block.offset);
+    PackBlock(counts, count_bits, packed_words.data() + block.offset + PackedWordCount(gap_bits));
+}
+
+PostingCursor::PostingCursor(const PostingList &postings)
+        : postings_(&postings) {
+    LoadBlock(0);
+}
+
+void PostingCursor::AdvanceTo(uint32_t ordinal) {
+    if (GetOrdinal() >= ordinal) {
+        return;
+    }
+    const size_t block = FindBlockIndex(ordinal);
+    if (block != block_) {
+        LoadBlock(block);
+        if (IsEnd()) {
+            return;
+        }
+    }
+    position_ = std::lower_bound(ordinals_ + position_, ordinals_ + block_size_, ordinal) - ordinals_;
+}
+
+void PostingCursor::GetPositions(std::vector<uint32_t> &positions) {
+    positions.clear();
+    if (!postings_->HasPositions()) {
+        return;
+    }
+    const auto &encoded = postings_->GetPositions();
+    const uint8_t *const end = encoded.data() + encoded.size();
+    const uint8_t *bytes = encoded.data() + positions_offset_;
+    for (; positions_posting_ < position_; ++positions_posting_) {
+        for (uint32_t i = 0; i < counts_[positions_posting_]; ++i) {
+            ReadVarint(bytes, end);
+        }
+    }
+    positions_offset_ = bytes - encoded.data();
+
+    uint32_t position = 0;
+    for (uint32_t i = 0; i < counts_[position_] && bytes != end; ++i) {
+        position += ReadVarint(bytes, end);
+        positions.push_back(position);
+    }
+}
+
+const PostingBlock *PostingCursor::FindBlock(uint32_t ordinal) const {
+    const size_t block = FindBlockIndex(ordinal);
+    return block == postings_->GetBlocks().size() ? nullptr : &postings_->GetBlocks()[block];
+}
+
+void PostingCursor::LoadBlock(size_t block) {
+    block_ = block;
+    position_ = 0;
+    block_size_ = IsEnd() ? 0 : postings_->DecodeBlock(block, ordinals_, counts_);
+    positions_posting_ = 0;
+    positions_offset_ = IsEnd() || !postings_->HasPositions() ? 0 : postings_->GetBlockPositionOffset(block);
+}
+
+size_t PostingCursor::FindBlockIndex(uint32_t ordinal) const {
+    const auto &blocks = postings_->GetBlocks();
+    size_t begin = block_;
+    size_t step = 1;
+    while (begin + step < blocks.size() && blocks[begin + step].last_ordinal < ordinal) {
+        begin += step;
+        step *= 2;
+    }
+    const size_t end = std::min(begin + step + 1, blocks.size());
+    return std::lower_bound(blocks.begin() + begin, blocks.begin() + end, ordinal,
+                            [](const PostingBlock &block, uint32_t value) {
+                                return block.last_ordinal < value;
+                            }) - blocks.begin();
+}
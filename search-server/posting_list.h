@@ -0,0 +1,171 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "bit_packing.h"
+#include "document_bitmap.h"
+#include "mapped_array.h"
+#include "snapshot.h"
+
+// Skip entry of a run of up to BLOCK_SIZE postings. Besides locating the packed data it bounds the
+// term frequency inside the block, which dynamic pruning uses to skip whole blocks.
+struct PostingBlock {
+    uint32_t first_ordinal;
+    uint32_t last_ordinal;
+    // Upper bound only: removed documents count until the list is rebuilt
+    double max_term_freq;
+    uint32_t offset;
+    uint8_t size;
+    uint8_t gap_bits;
+    uint8_t count_bits;
+};
+
+// Compressed posting list of a single term, sorted by document ordinal. Every posting keeps the number of
+// occurrences of the term in the document; term frequency is that count scaled by the document length.
+// Full blocks store ordinal gaps and counts bit-packed, the last incomplete block is kept unpacked.
+// A list built with positions also stores, for every posting, the positions of the term in the document
+// as varint-coded gaps; the positions of every block start at a recorded byte offset.
+// Postings of removed documents are not erased, the list only counts them; the owner skips them
+// and rebuilds the list when they make up too much of it.
+// Lists of frequent terms also keep the ordinals of their postings as a bitmap for set operations.
+class PostingList {
+public:
+    static constexpr size_t BLOCK_SIZE = PACKED_BLOCK_SIZE;
+    // Lists get a bitmap once they hold this many postings
+    static constexpr size_t BITMAP_MIN_SIZE = 4096;
+
+    // Ordinals are handed out in increasing order, so postings of a new document are always appended.
+    // positions holds count increasing positions of the term in the document; either every posting of
+    // the list has them or none.
+    void Add(uint32_t document_ordinal, uint32_t count, double term_freq, const uint32_t *positions = nullptr);
+
+    // Counts postings of removed documents
+    void MarkRemoved(size_t count = 1) {
+        removed_count_ += count;
+    }
+
+    // Number of postings of documents that are not removed
+    [[nodiscard]] size_t size() const {
+        return size_ - removed_count_;
+    }
+
+    [[nodiscard]] bool empty() const {
+        return size() == 0;
+    }
+
+    [[nodiscard]] size_t GetRemovedCount() const {
+        return removed_count_;
+    }
+
+    [[nodiscard]] double GetMaxTermFreq() const {
+        return max_term_freq_;
+    }
+
+    // Includes an entry for the unpacked tail, if any
+    [[nodiscard]] const MappedArray<PostingBlock> &GetBlocks() const {
+        return blocks_;
+    }
+
+    // Ordinals of all postings, removed ones included; nullptr for lists shorter than BITMAP_MIN_SIZE
+    [[nodiscard]] const DocumentBitmap *GetBitmap() const {
+        return bitmap_.empty() ? nullptr : &bitmap_;
+    }
+
+    [[nodiscard]] bool HasPositions() const {
+        return !block_position_offsets_.empty();
+    }
+
+    // Decodes a block into arrays of BLOCK_SIZE elements and returns the number of postings in it
+    size_t DecodeBlock(size_t block, uint32_t *ordinals, uint32_t *counts) const;
+
+    // Encoded positions of the postings of the list and the offset of those of every block
+    [[nodiscard]] const MappedArray<uint8_t> &GetPositions() const {
+        return positions_;
+    }
+
+    [[nodiscard]] uint32_t GetBlockPositionOffset(size_t block) const {
+        return block_position_offsets_[block];
+    }
+
+    void Save(SnapshotWriter &writer) const;
+
+    // The list refers to the mapped snapshot until it is modified.
+    // Throws runtime_error if a posting refers to an ordinal not below ordinal_count
+    static PostingList Load(SnapshotReader &reader, size_t ordinal_count);
+
+private:
+    static constexpr uint32_t TAIL_OFFSET = UINT32_MAX;
+
+    MappedArray<PostingBlock> blocks_;
+    MappedArray<uint32_t> packed_words_;
+    MappedArray<uint32_t> tail_ordinals_;
+    MappedArray<uint32_t> tail_counts_;
+    MappedArray<uint8_t> positions_;
+    MappedArray<uint32_t> block_position_offsets_;
+    DocumentBitmap bitmap_;
+    size_t size_ = 0;
+    size_t removed_count_ = 0;
+    double max_term_freq_ = 0.0;
+
+    [[nodiscard]] bool HasTail() const {
+        return !blocks_.empty() && blocks_.back().offset == TAIL_OFFSET;
+    }
+
+    // Packs the full tail block and appends it to the packed words
+    void EncodeBlock(PostingBlock &block, const uint32_t *ordinals, const uint32_t *counts);
+};
+
+// Forward-only iterator over a posting list that decodes one block at a time
+class PostingCursor {
+public:
+    static constexpr uint32_t END_ORDINAL = UINT32_MAX;
+
+    explicit PostingCursor(const PostingList &postings);
+
+    [[nodiscard]] bool IsEnd() const {
+        return block_ == postings_->GetBlocks().size();
+    }
+
+    // END_ORDINAL once the cursor is exhausted
+    [[nodiscard]] uint32_t GetOrdinal() const {
+        return IsEnd() ? END_ORDINAL : ordinals_[position_];
+    }
+
+    // Occurrences of the term in the current document
+    [[nodiscard]] uint32_t GetCount() const {
+        return counts_[position_];
+    }
+
+    void Next() {
+        if (++position_ == block_size_) {
+            LoadBlock(block_ + 1);
+        }
+    }
+
+    // Moves to the first posting with an ordinal not less than the given one
+    void AdvanceTo(uint32_t ordinal);
+
+    // Skip entry of the block that would hold the given ordinal, without moving the cursor.
+    // Returns nullptr if every remaining posting is before the ordinal.
+    [[nodiscard]] const PostingBlock *FindBlock(uint32_t ordinal) const;
+
+    // Replaces the contents of positions with the positions of the term in the current document; leaves it
+    // empty if the list has no positions
+    void GetPositions(std::vector<uint32_t> &positions);
+
+private:
+    const PostingList *postings_;
+    size_t block_ = 0;
+    size_t block_size_ = 0;
+    size_t position_ = 0;
+    uint32_t ordinals_[PostingList::BLOCK_SIZE];
+    uint32_t counts_[PostingList::BLOCK_SIZE];
+    // Positions of the block are decoded lazily: the offset of those of posting positions_posting_ is known
+    size_t positions_posting_ = 0;
+    size_t positions_offset_ = 0;
+
+    void LoadBlock(size_t block);
+
+    // Gallops from the current block, so short skips stay cheap in long lists
+    [[nodiscard]] size_t FindBlockIndex(uint32_t ordinal) const;
+};
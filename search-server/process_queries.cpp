@@ -2,10 +2,20 @@
 #include "algorithm"
 #include <execution>
 
+bool IsLongQuery(std::string_view raw_query) {
+    // Counts the words, not the spaces, so repeated spaces do not make a short query look long
+    size_t word_count = 0;
+    char previous = ' ';
+    for (const char c: raw_query) {
+        word_count += previous == ' ' && c != ' ';
+        previous = c;
+    }
+    return word_count >= LONG_QUERY_WORD_COUNT;
+}
 
 std::vector<std::vector<Document>> ProcessQueries(const SearchServer &search_server,
                                                   const std::vector<std::string> &queries) {
-    return ProcessQueries(std::execution::seq, search_server, queries);
+    return ProcessQueries(std::execution::par, search_server, queries);
 }
 
 
@@ -15,7 +25,7 @@ std::vector<std::vector<Document>> ProcessQueries(const std::execution::sequence
 
     std::vector<std::vector<Document>> result(queries.size());
 
-    std::transform(std::execution::par, queries.begin(), queries.end(), result.begin(),
+    std::transform(queries.begin(), queries.end(), result.begin(),
                    [&search_server](const std::string &str) {
                        return search_server.FindTopDocuments(str);
                    });
@@ -38,6 +48,18 @@ std::vector<std::vector<Document>> ProcessQueries(const std::execution::parallel
     return result;
 }
 
+std::vector<std::vector<Document>> ProcessQueries(QueryExecutor &executor, const SearchServer &search_server,
+                                                  const std::vector<std::string> &queries) {
+
+    std::vector<std::vector<Document>> result(queries.size());
+
+    ProcessQueries(executor, search_server, queries, [&result](size_t i, std::vector<Document> documents) {
+        result[i] = std::move(documents);
+    });
+
+    return result;
+}
+
 std::vector<Document> ProcessQueriesJoined(
         const SearchServer &search_server,
         const std::vector<std::string> &queries) {
@@ -52,4 +74,28 @@ std::vector<Document> ProcessQueriesJoined(
         }
     }
     return result;
+}
+
+std::vector<Document> ProcessQueriesJoined(QueryExecutor &executor, const SearchServer &search_server,
+                                           const std::vector<std::string> &queries) {
+    // Every query owns a fixed slot of MAX_RESULT_DOCUMENT_COUNT documents in one buffer,
+    // which is compacted in query order at the end
+    std::vector<Document> result(queries.size() * MAX_RESULT_DOCUMENT_COUNT);
+    std::vector<size_t> result_sizes(queries.size());
+
+    ProcessQueries(executor, search_server, queries, [&](size_t i, const std::vector<Document> &documents) {
+        std::copy(documents.begin(), documents.end(), result.begin() + i * MAX_RESULT_DOCUMENT_COUNT);
+        result_sizes[i] = documents.size();
+    });
+
+    size_t size = 0;
+    for (size_t i = 0; i < queries.size(); ++i) {
+        const auto slot = result.begin() + i * MAX_RESULT_DOCUMENT_COUNT;
+        if (slot != result.begin() + size) {
+            std::copy(slot, slot + result_sizes[i], result.begin() + size);
+        }
+        size += result_sizes[i];
+    }
+    result.resize(size);
+    return result;
 }
\ No newline at end of file
@@ -4,8 +4,14 @@
 #include "document.h"
 #include "search_server.h"
 #include <execution>
+#include "query_executor.h"
 #include "string_processing.h"
 
+// Queries with at least this many words are also split between the workers of a QueryExecutor
+const size_t LONG_QUERY_WORD_COUNT = 32;
+
+[[nodiscard]] bool IsLongQuery(std::string_view raw_query);
+
 std::vector<std::vector<Document>> ProcessQueries(const SearchServer &search_server,
                                                   const std::vector<std::string> &queries);
 
@@ -17,6 +23,30 @@ std::vector<std::vector<Document>> ProcessQueries(const std::execution::parallel
                                                   const SearchServer &search_server,
                                                   const std::vector<std::string> &queries);
 
+// Calls callback(query_index, documents) on a worker thread as soon as a query is done
+template<typename Callback>
+void ProcessQueries(QueryExecutor &executor, const SearchServer &search_server,
+                    const std::vector<std::string> &queries, Callback callback);
+
+std::vector<std::vector<Document>> ProcessQueries(QueryExecutor &executor, const SearchServer &search_server,
+                                                  const std::vector<std::string> &queries);
+
 std::vector<Document> ProcessQueriesJoined(
         const SearchServer &search_server,
-        const std::vector<std::string> &queries);
\ No newline at end of file
+        const std::vector<std::string> &queries);
+
+std::vector<Document> ProcessQueriesJoined(QueryExecutor &executor, const SearchServer &search_server,
+                                           const std::vector<std::string> &queries);
+
+template<typename Callback>
+void ProcessQueries(QueryExecutor &executor, const SearchServer &search_server,
+                    const std::vector<std::string> &queries, Callback callback) {
+    executor.ParallelFor(queries.size(), [&](size_t i) {
+        const auto &query = queries[i];
+        if (IsLongQuery(query)) {
+            callback(i, search_server.FindTopDocuments(executor, query));
+        } else {
+            callback(i, search_server.FindTopDocuments(query));
+        }
+    });
+}
\ No newline at end of file
@@ -0,0 +1,61 @@
+#include "query_cache.h"
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std::string_literals;
+
+QueryResultCache::QueryResultCache(size_t capacity, size_t shard_count)
+        : shards_(shard_count) {
+    if (capacity == 0 || shard_count == 0) {
+        throw std::invalid_argument("Query cache capacity and shard count must be positive"s);
+    }
+    shard_capacity_ = std::max<size_t>(1, capacity / shard_count);
+}
+
+std::optional<std::vector<Document>> QueryResultCache::Find(const std::string &key, uint64_t generation) {
+    auto &shard = GetShard(key);
+    std::lock_guard guard(shard.mutex);
+    const auto found = shard.index.find(key);
+    if (found == shard.index.end() || found->second->generation != generation) {
+        misses_.fetch_add(1, std::memory_order_relaxed);
+        return std::nullopt;
+    }
+    hits_.fetch_add(1, std::memory_order_relaxed);
+    shard.entries.splice(shard.entries.begin(), shard.entries, found->second);
+    return found->second->documents;
+}
+
+void QueryResultCache::Insert(std::string key, uint64_t generation, std::vector<Document> documents) {
+    auto &shard = GetShard(key);
+    std::lock_guard guard(shard.mutex);
+    const auto found = shard.index.find(key);
+    if (found != shard.index.end()) {
+        found->second->generation = generation;
+        found->second->documents = std::move(documents);
+        shard.entries.splice(shard.entries.begin(), shard.entries, found->second);
+        return;
+    }
+
+    if (shard.entries.size() == shard_capacity_) {
+        shard.index.erase(shard.entries.back().key);
+        shard.entries.pop_back();
+    }
+    // The index views the key stored in the list node, which never moves
+    shard.entries.push_front({std::move(key), generation, std::move(documents)});
+    shard.index.emplace(shard.entries.front().key, shard.entries.begin());
+}
+
+QueryCacheStats QueryResultCache::GetStats() const {
+    QueryCacheStats stats;
+    stats.hits = hits_.load(std::memory_order_relaxed);
+    stats.misses = misses_.load(std::memory_order_relaxed);
+    for (const auto &shard: shards_) {
+        std::lock_guard guard(shard.mutex);
+        stats.size += shard.entries.size();
+    }
+    return stats;
+}
+
+QueryResultCache::Shard &QueryResultCache::GetShard(const std::string &key) {
+    return shards_[std::hash<std::string>()(key) % shards_.size()];
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "document.h"
+
+struct QueryCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    size_t size = 0;
+};
+
+// LRU cache of query results split into independently locked shards. Every entry remembers the index
+// generation it was computed for, so bumping the generation invalidates the whole cache at once.
+class QueryResultCache {
+public:
+    QueryResultCache(size_t capacity, size_t shard_count);
+
+    // Returns nothing if the key is absent or was cached for another generation
+    std::optional<std::vector<Document>> Find(const std::string &key, uint64_t generation);
+
+    void Insert(std::string key, uint64_t generation, std::vector<Document> documents);
+
+    [[nodiscard]] QueryCacheStats GetStats() const;
+
+private:
+    struct Entry {
+        std::string key;
+        uint64_t generation;
+        std::vector<Document> documents;
+    };
+
+    struct Shard {
+        mutable std::mutex mutex;
+        // Most recently used entries first
+        std::list<Entry> entries;
+        std::unordered_map<std::string_view, std::list<Entry>::iterator> index;
+    };
+
+    std::vector<Shard> shards_;
+    size_t shard_capacity_;
+    std::atomic<uint64_t> hits_ = 0;
+    std::atomic<uint64_t> misses_ = 0;
+
+    Shard &GetShard(const std::string &key);
+};
@@ -0,0 +1,124 @@
+#include "query_executor.h"
+#include <algorithm>
+
+namespace {
+    // Executor and queue index of the calling worker thread
+    thread_local const void *current_executor = nullptr;
+    thread_local size_t current_worker_index = 0;
+}
+
+QueryExecutor::QueryExecutor(size_t worker_count)
+        : queues_(worker_count == 0 ? std::max(1u, std::thread::hardware_concurrency()) : worker_count) {
+    workers_.reserve(queues_.size());
+    for (size_t i = 0; i < queues_.size(); ++i) {
+        workers_.emplace_back([this, i] {
+            WorkerLoop(i);
+        });
+    }
+}
+
+QueryExecutor::~QueryExecutor() {
+    {
+        std::lock_guard guard(sleep_mutex_);
+        is_stopping_ = true;
+    }
+    wake_up_.notify_all();
+    for (auto &worker: workers_) {
+        worker.join();
+    }
+}
+
+void QueryExecutor::Submit(Job &job, size_t count) {
+    // Counted before they are published, so a worker taking one never brings the count below zero
+    queued_task_count_.fetch_add(count);
+    if (current_executor == this) {
+        // Tasks of a worker go to its own queue, idle workers steal them from there
+        auto &queue = queues_[current_worker_index];
+        std::lock_guard guard(queue.mutex);
+        for (size_t i = 0; i < count; ++i) {
+            queue.tasks.push_back({&job, i});
+        }
+    } else {
+        const size_t first_queue = next_queue_.fetch_add(1);
+        for (size_t i = 0; i < count; ++i) {
+            auto &queue = queues_[(first_queue + i) % queues_.size()];
+            std::lock_guard guard(queue.mutex);
+            queue.tasks.push_back({&job, i});
+        }
+    }
+
+    // Taking the lock orders this with a worker that is about to wait, so the wake-up is not lost
+    { std::lock_guard guard(sleep_mutex_); }
+    wake_up_.notify_all();
+}
+
+bool QueryExecutor::TryTakeTask(Task &task) {
+    if (queued_task_count_.load() == 0) {
+        return false;
+    }
+    const bool is_worker = current_executor == this;
+    if (is_worker) {
+        auto &queue = queues_[current_worker_index];
+        std::lock_guard guard(queue.mutex);
+        if (!queue.tasks.empty()) {
+            task = queue.tasks.back();
+            queue.tasks.pop_back();
+            queued_task_count_.fetch_sub(1);
+            return true;
+        }
+    }
+
+    const size_t first_victim = is_worker ? current_worker_index + 1 : 0;
+    for (size_t i = 0; i < queues_.size(); ++i) {
+        auto &queue = queues_[(first_victim + i) % queues_.size()];
+        std::lock_guard guard(queue.mutex);
+        if (!queue.tasks.empty()) {
+            task = queue.tasks.front();
+            queue.tasks.pop_front();
+            queued_task_count_.fetch_sub(1);
+            return true;
+        }
+    }
+    return false;
+}
+
+void QueryExecutor::RunTask(const Task &task) {
+    Job &job = *task.job;
+    try {
+        job.run(job.function, task.index);
+    } catch (...) {
+        std::lock_guard guard(job.error_mutex);
+        if (job.error == nullptr) {
+            job.error = std::current_exception();
+        }
+    }
+    if (job.is_detached) {
+        delete &job;
+        return;
+    }
+    // The job may be destroyed as soon as the waiter sees it done, so nothing touches it after the notification
+    if (job.remaining.fetch_sub(1) == 1) {
+        std::lock_guard guard(job.done_mutex);
+        job.is_done = true;
+        job.done.notify_one();
+    }
+}
+
+void QueryExecutor::WorkerLoop(size_t worker_index) {
+    current_executor = this;
+    current_worker_index = worker_index;
+    Task task{};
+    while (true) {
+        if (TryTakeTask(task)) {
+            RunTask(task);
+            continue;
+        }
+        std::unique_lock lock(sleep_mutex_);
+        wake_up_.wait(lock, [this] {
+            return is_stopping_ || queued_task_count_.load() != 0;
+        });
+        if (is_stopping_ && queued_task_count_.load() == 0) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Pool of persistent worker threads with work stealing: every worker takes tasks from its own queue and,
+// when that is empty, steals from the others. Threads stay alive between batches, so per-thread scratch
+// memory of the search server is reused by all queries the worker runs.
+class QueryExecutor {
+public:
+    // Zero worker_count means one worker per hardware thread
+    explicit QueryExecutor(size_t worker_count = 0);
+
+    QueryExecutor(const QueryExecutor &) = delete;
+
+    QueryExecutor &operator=(const QueryExecutor &) = delete;
+
+    ~QueryExecutor();
+
+    [[nodiscard]] size_t GetWorkerCount() const {
+        return workers_.size();
+    }
+
+    // Calls function(i) for every i below count and returns when all calls are done, rethrowing the first
+    // exception. Can be called from a task: the waiting thread runs queued tasks meanwhile and sleeps once
+    // none is left.
+    template<typename Function>
+    void ParallelFor(size_t count, Function function);
+
+    // Runs function() on a worker without waiting for it. Nothing reports an exception it throws.
+    template<typename Function>
+    void Post(Function function);
+
+private:
+    struct Job {
+        void (*run)(void *function, size_t index);
+        void *function;
+        std::atomic<size_t> remaining;
+        std::mutex error_mutex;
+        std::exception_ptr error;
+        // Set by the last task under the mutex, after which the waiter may destroy the job
+        std::mutex done_mutex;
+        std::condition_variable done;
+        bool is_done = false;
+        // A posted job owns its function and is deleted by its task
+        bool is_detached = false;
+    };
+
+    struct Task {
+        Job *job;
+        size_t index;
+    };
+
+    struct alignas(64) WorkerQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<WorkerQueue> queues_;
+    std::vector<std::thread> workers_;
+    std::atomic<size_t> queued_task_count_ = 0;
+    std::atomic<size_t> next_queue_ = 0;
+    std::mutex sleep_mutex_;
+    std::condition_variable wake_up_;
+    bool is_stopping_ = false;
+
+    void Submit(Job &job, size_t count);
+
+    // Takes a task from the queue of the calling worker or steals one from another queue
+    bool TryTakeTask(Task &task);
+
+    static void RunTask(const Task &task);
+
+    void WorkerLoop(size_t worker_index);
+};
+
+template<typename Function>
+void QueryExecutor::ParallelFor(size_t count, Function function) {
+    if (count == 0) {
+        return;
+    }
+    Job job;
+    job.run = [](void *function, size_t index) {
+        (*static_cast<Function *>(function))(index);
+    };
+    job.function = &function;
+    job.remaining = count;
+    Submit(job, count);
+
+    Task task{};
+    while (job.remaining.load() != 0 && TryTakeTask(task)) {
+        RunTask(task);
+    }
+    {
+        std::unique_lock lock(job.done_mutex);
+        job.done.wait(lock, [&job] {
+            return job.is_done;
+        });
+    }
+    if (job.error != nullptr) {
+        std::rethrow_exception(job.error);
+    }
+}
+
+template<typename Function>
+void QueryExecutor::Post(Function function) {
+    auto job = std::make_unique<Job>();
+    job->run = [](void *function, size_t) {
+        const std::unique_ptr<Function> owned_function(static_cast<Function *>(function));
+        (*owned_function)();
+    };
+    job->function = new Function(std::move(function));
+    job->remaining = 1;
+    job->is_detached = true;
+    Submit(*job.release(), 1);
+}
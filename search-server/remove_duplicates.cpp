@@ -1,25 +1,195 @@
 #include "remove_duplicates.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <execution>
+#include <iostream>
+#include <numeric>
+#include <tuple>
+#include <unordered_map>
 
+namespace {
+    // Terms of a document in term id order
+    using WordSet = DocumentWords;
 
-void RemoveDuplicates(SearchServer &search_server) {
+    const size_t MIN_HASH_COUNT = 128;
 
-    std::map<std::set<std::string>, std::set<int>> check_dubs; // Map из наборов слов и id документов
-    std::set<int> docs_to_remove;
+    uint64_t Mix(uint64_t x) {
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ULL;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
 
+    // Term ids are unique within a server, so sets of words are hashed and compared by them
+    uint64_t HashTerm(uint32_t term_id) {
+        return Mix(term_id + 0x9e3779b97f4a7c15ULL);
+    }
+
+    // Documents in increasing id order with their words. The views stay valid until the server is changed
+    std::vector<std::pair<int, WordSet>> GetDocuments(SearchServer &search_server) {
+        std::vector<std::pair<int, WordSet>> documents;
+        documents.reserve(search_server.GetDocumentCount());
+        for (const int document_id: search_server) {
+            documents.emplace_back(document_id, search_server.GetJustWords(document_id));
+        }
+        return documents;
+    }
+
+    bool HaveSameWords(const WordSet &lhs, const WordSet &rhs) {
+        if (lhs.size() != rhs.size()) {
+            return false;
+        }
+        for (auto l = lhs.begin(), r = rhs.begin(); l != lhs.end(); ++l, ++r) {
+            if (l.GetTermId() != r.GetTermId()) {
+                return false;
+            }
+        }
+        return true;
+    }
 
-    for(const auto &document: search_server){
-        std::set<std::string> to_emplace;
-        for(const auto& [word, freq]: search_server.GetWordFrequencies(document)){
-            to_emplace.emplace(word);
+    double ComputeJaccardSimilarity(const WordSet &lhs, const WordSet &rhs) {
+        if (lhs.empty() && rhs.empty()) {
+            return 1.0;
         }
-        check_dubs[to_emplace].emplace(document);
-        if(check_dubs.at(to_emplace).size() != 1){
-            docs_to_remove.emplace(document);
+        size_t common_count = 0;
+        for (auto l = lhs.begin(), r = rhs.begin(); l != lhs.end() && r != rhs.end();) {
+            if (l.GetTermId() < r.GetTermId()) {
+                ++l;
+            } else if (r.GetTermId() < l.GetTermId()) {
+                ++r;
+            } else {
+                ++common_count;
+                ++l;
+                ++r;
+            }
         }
+        return static_cast<double>(common_count) / static_cast<double>(lhs.size() + rhs.size() - common_count);
     }
 
-    for (const auto &doc: docs_to_remove) {
-        std::cout << "Found duplicate document id " << doc << std::endl;
-        search_server.RemoveDocument(doc);
+    // Pairs become LSH candidates with high probability once their similarity exceeds about
+    // (1 / band_count) ^ (1 / row_count); that point is kept below the threshold so that few pairs are missed
+    size_t ChooseRowCount(double min_similarity) {
+        size_t row_count = 1;
+        for (size_t rows = 2; rows <= MIN_HASH_COUNT; ++rows) {
+            const auto band_count = static_cast<double>(MIN_HASH_COUNT / rows);
+            if (std::pow(1.0 / band_count, 1.0 / static_cast<double>(rows)) > min_similarity - 0.1) {
+                break;
+            }
+            row_count = rows;
+        }
+        return row_count;
+    }
+
+    void RemoveDocuments(SearchServer &search_server, std::vector<int> &duplicates) {
+        std::sort(duplicates.begin(), duplicates.end());
+        for (const int document_id: duplicates) {
+            std::cout << "Found duplicate document id " << document_id << std::endl;
+        }
+        search_server.RemoveDocuments(duplicates);
     }
+}
+
+
+void RemoveDuplicates(SearchServer &search_server) {
+    const auto documents = GetDocuments(search_server);
+
+    // Order-independent 128-bit fingerprint of the set of words and the index of the document
+    std::vector<std::tuple<uint64_t, uint64_t, size_t>> fingerprints(documents.size());
+    std::vector<size_t> indexes(documents.size());
+    std::iota(indexes.begin(), indexes.end(), 0);
+    std::for_each(std::execution::par, indexes.begin(), indexes.end(), [&](size_t i) {
+        uint64_t low = 0;
+        uint64_t high = 0;
+        for (auto term = documents[i].second.begin(); term != documents[i].second.end(); ++term) {
+            const uint64_t hash = HashTerm(term.GetTermId());
+            low += hash;
+            high += Mix(hash ^ 0x9e3779b97f4a7c15ULL);
+        }
+        fingerprints[i] = {low, high, i};
+    });
+    std::sort(std::execution::par, fingerprints.begin(), fingerprints.end());
+
+    std::vector<int> duplicates;
+    std::vector<const WordSet *> distinct_words;
+    for (size_t begin = 0, end; begin < fingerprints.size(); begin = end) {
+        for (end = begin + 1; end < fingerprints.size() &&
+                              std::get<0>(fingerprints[end]) == std::get<0>(fingerprints[begin]) &&
+                              std::get<1>(fingerprints[end]) == std::get<1>(fingerprints[begin]); ++end) {
+        }
+        // Equal fingerprints almost always mean equal words, but a collision must not remove a document
+        distinct_words.clear();
+        for (size_t i = begin; i < end; ++i) {
+            const auto &[document_id, words] = documents[std::get<2>(fingerprints[i])];
+            if (std::any_of(distinct_words.begin(), distinct_words.end(), [&words = words](const WordSet *other) {
+                return HaveSameWords(words, *other);
+            })) {
+                duplicates.push_back(document_id);
+            } else {
+                distinct_words.push_back(&words);
+            }
+        }
+    }
+
+    RemoveDocuments(search_server, duplicates);
+}
+
+void RemoveDuplicates(SearchServer &search_server, double min_similarity) {
+    if (!(min_similarity > 0.0 && min_similarity <= 1.0)) {
+        throw std::invalid_argument("Similarity threshold must be in (0, 1]"s);
+    }
+    const auto documents = GetDocuments(search_server);
+    const size_t row_count = ChooseRowCount(min_similarity);
+    const size_t band_count = MIN_HASH_COUNT / row_count;
+
+    std::vector<uint64_t> band_keys(documents.size() * band_count);
+    std::vector<size_t> indexes(documents.size());
+    std::iota(indexes.begin(), indexes.end(), 0);
+    std::for_each(std::execution::par, indexes.begin(), indexes.end(), [&](size_t i) {
+        std::array<uint64_t, MIN_HASH_COUNT> signature;
+        signature.fill(UINT64_MAX);
+        for (auto term = documents[i].second.begin(); term != documents[i].second.end(); ++term) {
+            const uint64_t hash = HashTerm(term.GetTermId());
+            for (size_t k = 0; k < band_count * row_count; ++k) {
+                signature[k] = std::min(signature[k], Mix(hash + k * 0x9e3779b97f4a7c15ULL));
+            }
+        }
+        for (size_t band = 0; band < band_count; ++band) {
+            uint64_t key = band;
+            for (size_t row = 0; row < row_count; ++row) {
+                key = Mix(key ^ signature[band * row_count + row]);
+            }
+            band_keys[i * band_count + band] = key;
+        }
+    });
+
+    // Buckets hold only kept documents, so every document is compared with the kept ones it collides with
+    std::vector<std::unordered_map<uint64_t, std::vector<size_t>>> buckets(band_count);
+    std::vector<int> duplicates;
+    std::vector<size_t> candidates;
+    for (size_t i = 0; i < documents.size(); ++i) {
+        candidates.clear();
+        for (size_t band = 0; band < band_count; ++band) {
+            const auto bucket = buckets[band].find(band_keys[i * band_count + band]);
+            if (bucket != buckets[band].end()) {
+                candidates.insert(candidates.end(), bucket->second.begin(), bucket->second.end());
+            }
+        }
+        std::sort(candidates.begin(), candidates.end());
+        candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+        const auto &[document_id, words] = documents[i];
+        if (std::any_of(candidates.begin(), candidates.end(), [&, &words = words](size_t candidate) {
+            return ComputeJaccardSimilarity(words, documents[candidate].second) >= min_similarity;
+        })) {
+            duplicates.push_back(document_id);
+        } else {
+            for (size_t band = 0; band < band_count; ++band) {
+                buckets[band][band_keys[i * band_count + band]].push_back(i);
+            }
+        }
+    }
+
+    RemoveDocuments(search_server, duplicates);
 }
\ No newline at end of file
@@ -2,4 +2,10 @@
 #include "search_server.h"
 
 
-void RemoveDuplicates(SearchServer& search_server);
\ No newline at end of file
+// Removes every document whose set of words equals that of a document with a smaller id
+void RemoveDuplicates(SearchServer& search_server);
+
+// Also removes near duplicates: documents whose sets of words have Jaccard similarity of at least
+// min_similarity with a kept document of a smaller id. Candidates are found with MinHash and LSH, so a near
+// duplicate may occasionally be missed, but every removed document is checked against the exact similarity.
+void RemoveDuplicates(SearchServer& search_server, double min_similarity);
\ No newline at end of file
@@ -1,34 +1,114 @@
 #include "request_queue.h"
+#include <algorithm>
 
-RequestQueue::RequestQueue(const SearchServer &search_server) : search_server_(search_server) {
+namespace {
+    std::atomic<size_t> next_stripe_index = 0;
+    thread_local const size_t stripe_index = next_stripe_index.fetch_add(1);
+
+    // Clears the count of a counter holding a slice before end and returns the count taken out
+    uint64_t TakeExpiredCount(std::atomic<uint64_t> &counter, uint64_t end) {
+        uint64_t value = counter.load();
+        while ((value >> 32) < end && (value & UINT32_MAX) != 0) {
+            if (counter.compare_exchange_weak(value, value & ~uint64_t{UINT32_MAX})) {
+                return value & UINT32_MAX;
+            }
+        }
+        return 0;
+    }
 }
-std::vector<Document> RequestQueue::AddFindRequest(const std::string &raw_query, DocumentStatus status) {
-    ++current_minutes_counter_;
-    if (current_minutes_counter_ > min_in_day_) {
-        requests_.pop_front();
+
+RequestQueue::RequestQueue(const SearchServer &search_server, std::chrono::steady_clock::duration window)
+        : search_server_(search_server), start_(std::chrono::steady_clock::now()),
+          slice_duration_(window / BUCKET_COUNT) {
+    if (slice_duration_.count() <= 0) {
+        throw std::invalid_argument("Window is too short"s);
     }
+}
+
+std::vector<Document> RequestQueue::AddFindRequest(std::string_view raw_query, DocumentStatus status) {
     auto documents = search_server_.FindTopDocuments(raw_query, status);
-    requests_.push_back({raw_query, !empty(documents)});
+    Record(!documents.empty());
     return documents;
 }
 
-std::vector<Document> RequestQueue::AddFindRequest(const std::string &raw_query) {
-    ++current_minutes_counter_;
-    if (current_minutes_counter_ > min_in_day_) {
-        requests_.pop_front();
-    }
+std::vector<Document> RequestQueue::AddFindRequest(std::string_view raw_query) {
     auto documents = search_server_.FindTopDocuments(raw_query);
-    requests_.push_back({raw_query, !empty(documents)});
-
+    Record(!documents.empty());
     return documents;
 }
 
 int RequestQueue::GetNoResultRequests() const {
-    int no_results = 0;
-    for (const auto &request: requests_) {
-        if (!request.it_has_results) {
-            ++no_results;
+    return Sum(&Stripe::no_results);
+}
+
+int RequestQueue::GetRequestCount() const {
+    return Sum(&Stripe::requests);
+}
+
+void RequestQueue::Record(bool has_results) {
+    const uint64_t slice = GetCurrentSlice();
+    auto &stripe = stripes_[stripe_index % STRIPE_COUNT];
+    Count(stripe.requests, slice);
+    if (!has_results) {
+        Count(stripe.no_results, slice);
+    }
+}
+
+void RequestQueue::Count(Counts &counts, uint64_t slice) const {
+    auto &counter = counts.slices[slice % BUCKET_COUNT];
+    counts.total.fetch_add(1);
+    uint64_t value = counter.load();
+    while (true) {
+        if ((value >> 32) > slice) {
+            // A recorder of a later slice reused the counter, so this slice has expired already
+            counts.total.fetch_sub(1);
+            return;
         }
+        const uint64_t next = (value >> 32) == slice ? value + 1 : (slice << 32) | 1;
+        if (counter.compare_exchange_weak(value, next)) {
+            break;
+        }
+    }
+    if ((value >> 32) != slice) {
+        counts.total.fetch_sub(static_cast<int64_t>(value & UINT32_MAX));
+    }
+    // Either ExpireSlices sees the new count or this sees that the slice has expired meanwhile
+    if (slice < expired_slice_.load()) {
+        counts.total.fetch_sub(static_cast<int64_t>(TakeExpiredCount(counter, slice + 1)));
+    }
+}
+
+void RequestQueue::ExpireSlices(uint64_t current_slice) const {
+    if (current_slice < BUCKET_COUNT) {
+        return;
+    }
+    const uint64_t end = current_slice - BUCKET_COUNT + 1;
+    uint64_t begin = expired_slice_.load();
+    while (begin < end && !expired_slice_.compare_exchange_weak(begin, end)) {
+    }
+    if (begin >= end) {
+        return;
+    }
+    // Every bucket is visited at most once, however long nobody read the totals
+    for (uint64_t slice = std::max(begin, end - std::min<uint64_t>(end, BUCKET_COUNT)); slice < end; ++slice) {
+        for (auto &stripe: stripes_) {
+            for (Counts *counts: {&stripe.requests, &stripe.no_results}) {
+                const uint64_t expired_count = TakeExpiredCount(counts->slices[slice % BUCKET_COUNT], end);
+                counts->total.fetch_sub(static_cast<int64_t>(expired_count));
+            }
+        }
+    }
+}
+
+uint64_t RequestQueue::GetCurrentSlice() const {
+    return static_cast<uint64_t>((std::chrono::steady_clock::now() - start_) / slice_duration_);
+}
+
+int RequestQueue::Sum(Counts Stripe::*counts) const {
+    ExpireSlices(GetCurrentSlice());
+    int64_t sum = 0;
+    for (const auto &stripe: stripes_) {
+        sum += (stripe.*counts).total.load();
     }
-    return no_results;
+    return static_cast<int>(sum);
 }
\ No newline at end of file
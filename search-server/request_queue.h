@@ -1,47 +1,73 @@
 #pragma once
-#include <string>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <string_view>
 #include "search_server.h"
 #include <vector>
-#include <deque>
-#include <set>
-
-
 
 
+// Counts requests and requests without results over a sliding window of wall-clock time. The window is
+// split into BUCKET_COUNT time slices, so it is exact up to one slice. Recording is lock-free and every
+// thread counts into its own stripe of counters; every stripe keeps a running total of the window, which
+// drops the counts of a slice once it expires, so a read sums STRIPE_COUNT totals. Safe to use from many threads.
 class RequestQueue {
 public:
+    static constexpr size_t BUCKET_COUNT = 60;
 
-    template<typename DocumentPredicate>
-    std::vector<Document> AddFindRequest(const std::string &raw_query, DocumentPredicate document_predicate);
+    explicit RequestQueue(const SearchServer &search_server,
+                          std::chrono::steady_clock::duration window = std::chrono::hours(24));
 
-    explicit RequestQueue(const SearchServer &search_server);
+    template<typename DocumentPredicate>
+    std::vector<Document> AddFindRequest(std::string_view raw_query, DocumentPredicate document_predicate);
 
-    std::vector<Document> AddFindRequest(const std::string &raw_query, DocumentStatus status);
+    std::vector<Document> AddFindRequest(std::string_view raw_query, DocumentStatus status);
 
-    std::vector<Document> AddFindRequest(const std::string &raw_query);
+    std::vector<Document> AddFindRequest(std::string_view raw_query);
 
     [[nodiscard]] int GetNoResultRequests() const;
 
+    [[nodiscard]] int GetRequestCount() const;
+
 private:
-    struct QueryResult {
-        std::string request;
-        bool it_has_results;
+    static constexpr size_t STRIPE_COUNT = 8;
+
+    // Upper half of a slice counter is the number of the time slice it counts, so a counter left from an
+    // older slice is reset by the same atomic operation that counts the new request. Whoever takes an
+    // expired count out of a counter, by resetting or by clearing it, subtracts it from the total.
+    struct Counts {
+        std::array<std::atomic<uint64_t>, BUCKET_COUNT> slices{};
+        std::atomic<int64_t> total = 0;
+    };
+
+    struct alignas(64) Stripe {
+        Counts requests;
+        Counts no_results;
     };
-    std::deque<QueryResult> requests_;
-    const static int min_in_day_ = 1440;
+
     const SearchServer &search_server_;
-    int current_minutes_counter_ = 0;
+    const std::chrono::steady_clock::time_point start_;
+    const std::chrono::steady_clock::duration slice_duration_;
+    mutable std::array<Stripe, STRIPE_COUNT> stripes_;
+    // Counts of the slices before it are out of the totals, except those a recorder is still adding
+    mutable std::atomic<uint64_t> expired_slice_ = 0;
+
+    void Record(bool has_results);
+
+    void Count(Counts &counts, uint64_t slice) const;
+
+    // Takes the counts of the slices that left the window out of the totals
+    void ExpireSlices(uint64_t current_slice) const;
+
+    [[nodiscard]] uint64_t GetCurrentSlice() const;
+
+    [[nodiscard]] int Sum(Counts Stripe::*counts) const;
 };
 
 
 template<typename DocumentPredicate>
-std::vector<Document> RequestQueue::AddFindRequest(const std::string &raw_query, DocumentPredicate document_predicate) {
-    ++current_minutes_counter_;
-    if (current_minutes_counter_ > min_in_day_) {
-        requests_.pop_front();
-    }
+std::vector<Document> RequestQueue::AddFindRequest(std::string_view raw_query, DocumentPredicate document_predicate) {
     auto documents = search_server_.FindTopDocuments(raw_query, document_predicate);
-    requests_.push_back({raw_query, !empty(documents)});
+    Record(!documents.empty());
     return documents;
 }
-
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// Dense per-query relevance accumulator indexed by document ordinal. Slots are reset lazily with an
+// epoch stamp, so a reused accumulator does not clear or allocate anything between queries.
+class ScoreAccumulator {
+public:
+    // Starts a new query over documents with ordinals below ordinal_count
+    void Reset(size_t ordinal_count) {
+        if (scores_.size() < ordinal_count) {
+            scores_.resize(ordinal_count);
+            stamps_.resize(ordinal_count, 0);
+        }
+        touched_.clear();
+        if (++epoch_ == 0) {
+            std::fill(stamps_.begin(), stamps_.end(), 0);
+            epoch_ = 1;
+        }
+    }
+
+    void Add(uint32_t ordinal, double score) {
+        if (stamps_[ordinal] != epoch_) {
+            stamps_[ordinal] = epoch_;
+            scores_[ordinal] = 0.0;
+            touched_.push_back(ordinal);
+        }
+        scores_[ordinal] += score;
+    }
+
+    template<typename Function>
+    void ForEach(Function function) const {
+        for (const uint32_t ordinal: touched_) {
+            if (stamps_[ordinal] == epoch_) {
+                function(ordinal, scores_[ordinal]);
+            }
+        }
+    }
+
+private:
+    std::vector<double> scores_;
+    std::vector<uint32_t> stamps_;
+    std::vector<uint32_t> touched_;
+    uint32_t epoch_ = 0;
+};
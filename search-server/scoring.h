@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <string_view>
+
+// Relevance models for FindTopDocuments. A scorer is a type constructed for every query from the average
+// number of words in a document; relevance of a document is the sum over the query words it contains of
+// ScoreTermFreq(...) * ComputeInverseDocumentFreq(...). GetMaxTermScore bounds ScoreTermFreq from above by
+// the maximum term frequency (count / word count) of a list or a block, which dynamic pruning relies on.
+// NAME tells the scorers apart in query cache keys. Scorers are template arguments, so the scoring of a
+// posting is inlined into the evaluation loops.
+namespace scoring {
+    // Term frequency scaled by document length times log(N / df)
+    class TfIdf {
+    public:
+        static constexpr std::string_view NAME = "tf-idf";
+
+        explicit TfIdf(double /*average_word_count*/) {
+        }
+
+        static double ComputeInverseDocumentFreq(double document_count, double document_freq) {
+            return std::log(document_count / document_freq);
+        }
+
+        [[nodiscard]] double ScoreTermFreq(uint32_t count, uint32_t /*word_count*/, double inv_word_count) const {
+            return count * inv_word_count;
+        }
+
+        [[nodiscard]] double GetMaxTermScore(double max_term_freq) const {
+            return max_term_freq;
+        }
+    };
+
+    // Okapi BM25 with k1 = 1.2 and b = 0.75
+    class Bm25 {
+    public:
+        static constexpr std::string_view NAME = "bm25";
+        static constexpr double K1 = 1.2;
+        static constexpr double B = 0.75;
+
+        explicit Bm25(double average_word_count)
+                : length_norm_(K1 * B / average_word_count) {
+        }
+
+        static double ComputeInverseDocumentFreq(double document_count, double document_freq) {
+            return std::log(1.0 + (document_count - document_freq + 0.5) / (document_freq + 0.5));
+        }
+
+        [[nodiscard]] double ScoreTermFreq(uint32_t count, uint32_t word_count, double /*inv_word_count*/) const {
+            return count * (K1 + 1.0) / (count + K1 * (1.0 - B) + length_norm_ * word_count);
+        }
+
+        // For a fixed ratio of count to word count the score grows with the word count and tends to this bound
+        [[nodiscard]] double GetMaxTermScore(double max_term_freq) const {
+            return (K1 + 1.0) * max_term_freq / (max_term_freq + length_norm_);
+        }
+
+    private:
+        // k1 * b / average word count, the part of the length norm that grows with the document
+        double length_norm_;
+    };
+
+    // BM25+ with delta = 1: every occurrence scores at least delta, so long documents are not penalized
+    // below documents missing the word
+    class Bm25Plus : public Bm25 {
+    public:
+        static constexpr std::string_view NAME = "bm25+";
+        static constexpr double DELTA = 1.0;
+
+        using Bm25::Bm25;
+
+        [[nodiscard]] double ScoreTermFreq(uint32_t count, uint32_t word_count, double inv_word_count) const {
+            return Bm25::ScoreTermFreq(count, word_count, inv_word_count) + DELTA;
+        }
+
+        [[nodiscard]] double GetMaxTermScore(double max_term_freq) const {
+            return Bm25::GetMaxTermScore(max_term_freq) + DELTA;
+        }
+    };
+}
@@ -4,7 +4,59 @@
 #include <algorithm>
 #include <numeric>
 #include <deque>
-#include <list>
+#include <atomic>
+#include <thread>
+#include <unordered_map>
+
+namespace {
+    // Snapshot records of a live document and of an entry of its word frequencies
+    struct SnapshotDocument {
+        int32_t id;
+        uint32_t ordinal;
+        uint64_t text_offset;
+        uint64_t text_size;
+        uint64_t first_term;
+        uint64_t term_count;
+    };
+
+    // Calls function(term, count, positions) for every term of (term, position) pairs sorted by term and
+    // then by position, so the positions of every term come in increasing order
+    template<typename Term, typename Function>
+    void ForEachTerm(const std::vector<std::pair<Term, uint32_t>> &term_positions, Function function) {
+        static thread_local std::vector<uint32_t> positions;
+        for (size_t begin = 0, end; begin < term_positions.size(); begin = end) {
+            positions.clear();
+            for (end = begin; end < term_positions.size() && term_positions[end].first == term_positions[begin].first;
+                 ++end) {
+                positions.push_back(term_positions[end].second);
+            }
+            function(term_positions[begin].first, static_cast<uint32_t>(end - begin), positions.data());
+        }
+    }
+
+    // True if the lists hold increasing positions of the words of a phrase, each word following the
+    // previous one with at most slop words between them
+    bool ContainsPhrase(const std::vector<const std::vector<uint32_t> *> &word_positions, uint32_t slop) {
+        // Positions of the current word at which the phrase so far can end
+        static thread_local std::vector<uint32_t> ends;
+        static thread_local std::vector<uint32_t> next_ends;
+        ends = *word_positions.front();
+        for (size_t i = 1; i < word_positions.size() && !ends.empty(); ++i) {
+            next_ends.clear();
+            size_t end = 0;
+            for (const uint32_t position: *word_positions[i]) {
+                while (end < ends.size() && uint64_t{ends[end]} + slop + 1 < position) {
+                    ++end;
+                }
+                if (end < ends.size() && ends[end] < position) {
+                    next_ends.push_back(position);
+                }
+            }
+            ends.swap(next_ends);
+        }
+        return !ends.empty();
+    }
+}
 
 SearchServer::SearchServer(const std::string &stop_words_text)
         : SearchServer(SplitIntoWords(stop_words_text))  // Invoke delegating constructor from string container
@@ -17,131 +69,295 @@ void SearchServer::AddDocument(int document_id, const std::string_view document,
     if ((document_id < 0) || (documents_.count(document_id) > 0)) {
         throw std::invalid_argument("Invalid document_id"s);
     }
-    auto words = SplitIntoWordsNoStop(document);
-    const std::string str_document{document};
-
-    documents_.emplace(document_id, DocumentData{ComputeAverageRating(ratings), status, str_document});
-
-    words = SplitIntoWordsNoStop(documents_.at(document_id).data);
+    static thread_local std::vector<std::string_view> words;
+    SplitIntoWordsNoStop(document, words);
 
+    const auto document_ordinal = static_cast<uint32_t>(ordinal_to_document_id_.size());
     const double inv_word_count = 1.0 / static_cast<double>(words.size());
-    for (const auto &word: words) {
-        word_to_document_freqs_[word][document_id] += inv_word_count;
-        docId_to_word_freq_[document_id][word] += inv_word_count;
+    ordinal_to_document_id_.Mutable().push_back(document_id);
+    ordinal_to_inv_word_count_.Mutable().push_back(inv_word_count);
+    ordinal_to_word_count_.Mutable().push_back(static_cast<uint32_t>(words.size()));
+    ordinal_to_rating_.Mutable().push_back(ComputeAverageRating(ratings));
+    ordinal_to_status_.Mutable().push_back(status);
+    total_word_count_ += words.size();
+
+    static thread_local std::vector<std::pair<uint32_t, uint32_t>> term_positions;
+    term_positions.clear();
+    for (size_t position = 0; position < words.size(); ++position) {
+        term_positions.emplace_back(InternTerm(words[position]), static_cast<uint32_t>(position));
     }
+    const size_t old_term_count = term_postings_.size();
+    term_postings_.resize(term_dictionary_.size());
+
+    auto &forward_index = forward_index_.Mutable();
+    const size_t first_term = forward_index.size();
+    std::sort(term_positions.begin(), term_positions.end());
+    ForEachTerm(term_positions, [&](uint32_t term_id, uint32_t count, const uint32_t *positions) {
+        // An emptied term gets a document again
+        if (term_id < old_term_count && term_postings_[term_id].empty()) {
+            --emptied_term_count_;
+        }
+        term_postings_[term_id].Add(document_ordinal, count, count * inv_word_count,
+                                    has_positions_ ? positions : nullptr);
+        forward_index.push_back({term_id, count});
+    });
+
+    documents_.emplace(document_id, DocumentData{text_arena_.Append(document), document_ordinal, first_term,
+                                                 static_cast<uint32_t>(forward_index.size() - first_term)});
 
     document_ids_.emplace(document_id);
+    ++generation_;
 }
 
-std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status) const {
-    return FindTopDocuments(
-            raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
-                return document_status == status;
-            });
+void SearchServer::AddDocuments(const std::vector<DocumentInput> &documents) {
+    AddDocuments(std::execution::par, documents);
 }
 
-std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query) const {
-    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+void SearchServer::AddDocuments(const std::execution::sequenced_policy &, const std::vector<DocumentInput> &documents) {
+    AddDocumentsImpl(std::execution::seq, documents, 1);
 }
 
-int SearchServer::GetDocumentCount() const {
-    return static_cast<int>(documents_.size());
+void SearchServer::AddDocuments(const std::execution::parallel_policy &, const std::vector<DocumentInput> &documents) {
+    const size_t chunk_count = std::max(1u, std::thread::hardware_concurrency()) * 4;
+    AddDocumentsImpl(std::execution::par, documents, std::min(chunk_count, std::max<size_t>(documents.size(), 1)));
 }
 
-std::tuple<std::vector<std::string_view>, DocumentStatus>
-SearchServer::MatchDocument(const std::execution::parallel_policy &, std::string_view raw_query,
-                            int document_id) const {
+template<typename ExecutionPolicy>
+void SearchServer::AddDocumentsImpl(const ExecutionPolicy &executionPolicy, const std::vector<DocumentInput> &documents,
+                                    size_t chunk_count) {
+    std::set<int> new_document_ids;
+    for (const auto &document: documents) {
+        if (document.id < 0 || documents_.count(document.id) > 0 || !new_document_ids.insert(document.id).second) {
+            throw std::invalid_argument("Invalid document_id"s);
+        }
+    }
 
-    const auto query = ParseQuery(std::execution::par, raw_query);
-    std::vector<std::string_view> matched_words(query.plus_words.size());
+    std::vector<size_t> indexes(documents.size());
+    std::iota(indexes.begin(), indexes.end(), 0);
+    std::vector<std::vector<std::string_view>> document_words(documents.size());
+    std::atomic_bool has_wrong_word = false;
+    std::for_each(executionPolicy, indexes.begin(), indexes.end(), [&](size_t i) {
+        auto &words = document_words[i];
+        if (!SplitIntoValidWords(documents[i].text, words)) {
+            has_wrong_word = true;
+            return;
+        }
+        words.erase(std::remove_if(words.begin(), words.end(), [this](std::string_view word) {
+            return IsStopWord(word);
+        }), words.end());
+    });
+    if (has_wrong_word) {
+        throw std::invalid_argument("Wrong word");
+    }
 
-    if (std::any_of(std::execution::par, query.minus_words.begin(), query.minus_words.end(),
-                    [this, &document_id](const auto &word) {
-                        return (docId_to_word_freq_.at(document_id).count(word));
-                    })) {
-        matched_words.clear();
-        return {matched_words, documents_.at(document_id).status};
+    const auto first_ordinal = static_cast<uint32_t>(ordinal_to_document_id_.size());
+    auto &ordinal_to_document_id = ordinal_to_document_id_.Mutable();
+    auto &ordinal_to_inv_word_count = ordinal_to_inv_word_count_.Mutable();
+    auto &ordinal_to_word_count = ordinal_to_word_count_.Mutable();
+    auto &ordinal_to_rating = ordinal_to_rating_.Mutable();
+    auto &ordinal_to_status = ordinal_to_status_.Mutable();
+    std::vector<DocumentData *> stored_documents;
+    stored_documents.reserve(documents.size());
+    for (size_t i = 0; i < documents.size(); ++i) {
+        const auto &document = documents[i];
+        stored_documents.push_back(&documents_.emplace(
+                document.id, DocumentData{text_arena_.Append(document.text), static_cast<uint32_t>(first_ordinal + i),
+                                          0, 0}).first->second);
+        ordinal_to_document_id.push_back(document.id);
+        ordinal_to_inv_word_count.push_back(1.0 / static_cast<double>(document_words[i].size()));
+        ordinal_to_word_count.push_back(static_cast<uint32_t>(document_words[i].size()));
+        ordinal_to_rating.push_back(ComputeAverageRating(document.ratings));
+        ordinal_to_status.push_back(document.status);
+        total_word_count_ += document_words[i].size();
+        document_ids_.emplace(document.id);
     }
 
+    // Every chunk indexes a contiguous run of ordinals, so merging chunks in order keeps posting lists sorted
+    struct ChunkPosting {
+        uint32_t document_ordinal;
+        uint32_t count;
+        double term_freq;
+    };
+    struct ChunkTerm {
+        uint32_t term_id = 0;
+        std::vector<ChunkPosting> postings;
+        // Positions of all postings one after another, if the positional index is enabled
+        std::vector<uint32_t> positions;
+    };
+    struct Chunk {
+        std::unordered_map<std::string_view, ChunkTerm> terms;
+        // Terms of every document of the chunk with their counts; term ids are known after the merge
+        std::vector<std::vector<std::pair<const ChunkTerm *, uint32_t>>> document_terms;
+    };
+    std::vector<Chunk> chunks(chunk_count);
+    std::vector<size_t> chunk_indexes(chunk_count);
+    std::iota(chunk_indexes.begin(), chunk_indexes.end(), 0);
+    std::for_each(executionPolicy, chunk_indexes.begin(), chunk_indexes.end(), [&](size_t chunk_index) {
+        auto &chunk = chunks[chunk_index];
+        const size_t begin = documents.size() * chunk_index / chunk_count;
+        const size_t end = documents.size() * (chunk_index + 1) / chunk_count;
+        for (size_t i = begin; i < end; ++i) {
+            const uint32_t document_ordinal = first_ordinal + static_cast<uint32_t>(i);
+            const double inv_word_count = ordinal_to_inv_word_count_[document_ordinal];
+            const auto &words = document_words[i];
+            auto &document_terms = chunk.document_terms.emplace_back();
+            static thread_local std::vector<std::pair<std::string_view, uint32_t>> word_positions;
+            word_positions.clear();
+            for (size_t position = 0; position < words.size(); ++position) {
+                word_positions.emplace_back(words[position], static_cast<uint32_t>(position));
+            }
+            std::sort(word_positions.begin(), word_positions.end());
+            ForEachTerm(word_positions, [&](std::string_view word, uint32_t count, const uint32_t *positions) {
+                auto &term = chunk.terms[word];
+                term.postings.push_back({document_ordinal, count, count * inv_word_count});
+                if (has_positions_) {
+                    term.positions.insert(term.positions.end(), positions, positions + count);
+                }
+                document_terms.emplace_back(&term, count);
+            });
+        }
+    });
 
-    const auto &x = std::copy_if(std::execution::par, query.plus_words.begin(), query.plus_words.end(),
-                                 matched_words.begin(),
-                                 [this, &document_id](const auto &word) {
-                                     return docId_to_word_freq_.at(document_id).count(word);
-                                 });
-    matched_words.erase(x, matched_words.end());
+    auto &forward_index = forward_index_.Mutable();
+    size_t document_index = 0;
+    for (auto &chunk: chunks) {
+        for (auto &[word, term]: chunk.terms) {
+            term.term_id = InternTerm(word);
+            if (term.term_id == term_postings_.size()) {
+                term_postings_.emplace_back();
+            } else if (term_postings_[term.term_id].empty()) {
+                --emptied_term_count_;
+            }
+            const uint32_t *positions = term.positions.data();
+            for (const auto &posting: term.postings) {
+                term_postings_[term.term_id].Add(posting.document_ordinal, posting.count, posting.term_freq,
+                                                 has_positions_ ? positions : nullptr);
+                positions += has_positions_ ? posting.count : 0;
+            }
+        }
+        for (const auto &document_terms: chunk.document_terms) {
+            auto &document = *stored_documents[document_index++];
+            document.first_term = forward_index.size();
+            for (const auto &[term, count]: document_terms) {
+                forward_index.push_back({term->term_id, count});
+            }
+            std::sort(forward_index.begin() + static_cast<std::ptrdiff_t>(document.first_term), forward_index.end(),
+                      [](const DocumentTerm &lhs, const DocumentTerm &rhs) {
+                          return lhs.term_id < rhs.term_id;
+                      });
+            document.term_count = static_cast<uint32_t>(forward_index.size() - document.first_term);
+        }
+    }
+    ++generation_;
+}
 
-    std::sort(std::execution::par, matched_words.begin(), matched_words.end());
-    auto pend = std::unique(std::execution::par, matched_words.begin(), matched_words.end());
-    matched_words.erase(pend, matched_words.end());
+int SearchServer::GetDocumentCount() const {
+    return static_cast<int>(documents_.size());
+}
 
-    return {matched_words, documents_.at(document_id).status};
+void SearchServer::EnableQueryCache(size_t capacity, size_t shard_count) {
+    query_cache_ = std::make_unique<QueryResultCache>(capacity, shard_count);
 }
 
-std::tuple<std::vector<std::string_view>, DocumentStatus>
-SearchServer::MatchDocument(const std::execution::sequenced_policy &, std::string_view raw_query,
-                            int document_id) const {
+QueryCacheStats SearchServer::GetQueryCacheStats() const {
+    return query_cache_ ? query_cache_->GetStats() : QueryCacheStats();
+}
 
-    if (!IsValidWord(raw_query)) {
-        throw std::invalid_argument("Query word is invalid");
+void SearchServer::EnablePositionalIndex() {
+    if (has_positions_) {
+        return;
     }
-
-    const auto query = ParseQuery(raw_query);
-    std::vector<std::string_view> matched_words;
-
-    auto &words = docId_to_word_freq_.at(document_id);
-
-    for (const auto &word: query.plus_words) {
-        if (words.count(word) == 0) {
+    // Positions are not kept anywhere, so the posting lists are built again from the stored texts
+    std::vector<PostingList> term_postings(term_postings_.size());
+    std::vector<std::string_view> words;
+    std::vector<std::pair<uint32_t, uint32_t>> term_positions;
+    for (uint32_t ordinal = 0; ordinal < ordinal_to_document_id_.size(); ++ordinal) {
+        const int document_id = ordinal_to_document_id_[ordinal];
+        if (document_id == REMOVED_DOCUMENT_ID) {
             continue;
-        } else {
-            matched_words.push_back(word);
         }
-    }
-
-    for (const auto &word: query.minus_words) {
-        if (words.count(word) == 0) {
-            continue;
-        } else {
-            matched_words.clear();
-            break;
+        SplitIntoWordsNoStop(documents_.at(document_id).text, words);
+        term_positions.clear();
+        for (size_t position = 0; position < words.size(); ++position) {
+            term_positions.emplace_back(term_dictionary_.Find(words[position]), static_cast<uint32_t>(position));
         }
+        std::sort(term_positions.begin(), term_positions.end());
+        const double inv_word_count = ordinal_to_inv_word_count_[ordinal];
+        ForEachTerm(term_positions, [&](uint32_t term_id, uint32_t count, const uint32_t *positions) {
+            term_postings[term_id].Add(ordinal, count, count * inv_word_count, positions);
+        });
     }
+    term_postings_ = std::move(term_postings);
+    has_positions_ = true;
+    ++generation_;
+}
 
-    return {matched_words, documents_.at(document_id).status};
+void SearchServer::SetCollectionStatistics(const CollectionStatistics *statistics) {
+    collection_statistics_ = statistics;
+    ++generation_;
 }
 
+std::tuple<std::vector<std::string_view>, DocumentStatus>
+SearchServer::MatchDocument(const std::execution::parallel_policy &, std::string_view raw_query,
+                            int document_id) const {
+    return MatchQuery(ParseQuery(std::execution::par, raw_query), document_id);
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus>
+SearchServer::MatchDocument(const std::execution::sequenced_policy &, std::string_view raw_query,
+                            int document_id) const {
+    return MatchQuery(ParseQuery(raw_query), document_id);
+}
 
 std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(std::string_view raw_query,
                                                                                       int document_id) const {
+    return MatchDocument(std::execution::seq, raw_query, document_id);
+}
 
-    if (!IsValidWord(raw_query)) {
-        throw std::invalid_argument("Query word is invalid");
-    }
-
-    const auto query = ParseQuery(raw_query);
+std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchQuery(const Query &query,
+                                                                                   int document_id) const {
+    const auto &document = documents_.at(document_id);
+    const DocumentStatus status = ordinal_to_status_[document.ordinal];
     std::vector<std::string_view> matched_words;
+    FindDocumentWords(document, query.minus_words, matched_words);
+    if (!matched_words.empty()) {
+        matched_words.clear();
+        return {matched_words, status};
+    }
+    if (!query.phrases.empty() && PhraseMatcher(*this, query.phrases).FindNext(document.ordinal) != document.ordinal) {
+        return {matched_words, status};
+    }
 
-    auto &words = docId_to_word_freq_.at(document_id);
+    FindDocumentWords(document, query.plus_words, matched_words);
+    std::sort(matched_words.begin(), matched_words.end());
+    matched_words.erase(std::unique(matched_words.begin(), matched_words.end()), matched_words.end());
+    return {matched_words, status};
+}
 
-    for (const auto &word: query.plus_words) {
-        if (words.count(word) == 0) {
-            continue;
-        } else {
-            matched_words.push_back(word);
+void SearchServer::FindDocumentWords(const DocumentData &document, const std::vector<std::string_view> &words,
+                                     std::vector<std::string_view> &matched_words) const {
+    std::vector<std::pair<uint32_t, std::string_view>> terms;
+    for (const auto &word: words) {
+        const uint32_t term_id = term_dictionary_.Find(word);
+        if (term_id != TermDictionary::NO_TERM) {
+            terms.emplace_back(term_id, word);
         }
     }
-
-    for (const auto &word: query.minus_words) {
-        if (words.count(word) == 0) {
-            continue;
-        } else {
-            matched_words.clear();
+    std::sort(terms.begin(), terms.end());
+
+    const DocumentTerm *position = GetDocumentTerms(document);
+    const DocumentTerm *const end = position + document.term_count;
+    for (const auto &[term_id, word]: terms) {
+        position = std::lower_bound(position, end, term_id, [](const DocumentTerm &term, uint32_t id) {
+            return term.term_id < id;
+        });
+        if (position == end) {
             break;
         }
+        if (position->term_id == term_id) {
+            matched_words.push_back(word);
+        }
     }
-
-    return {matched_words, documents_.at(document_id).status};
 }
 
 bool SearchServer::IsStopWord(const std::string_view word) const {
@@ -155,17 +371,13 @@ bool SearchServer::IsValidWord(const std::string_view word) {
     });
 }
 
-std::vector<std::string_view> SearchServer::SplitIntoWordsNoStop(const std::string_view text) const {
-    std::vector<std::string_view> words;
-    for (const auto &word: SplitIntoWordsStrView(text)) {
-        if (!IsValidWord(word)) {
-            throw std::invalid_argument("Wrong word");
-        }
-        if (!IsStopWord(word)) {
-            words.push_back(word);
-        }
+void SearchServer::SplitIntoWordsNoStop(const std::string_view text, std::vector<std::string_view> &words) const {
+    if (!SplitIntoValidWords(text, words)) {
+        throw std::invalid_argument("Wrong word");
     }
-    return words;
+    words.erase(std::remove_if(words.begin(), words.end(), [this](std::string_view word) {
+        return IsStopWord(word);
+    }), words.end());
 }
 
 int SearchServer::ComputeAverageRating(const std::vector<int> &ratings) {
@@ -176,8 +388,74 @@ int SearchServer::ComputeAverageRating(const std::vector<int> &ratings) {
     return rating_sum / static_cast<int>(ratings.size());
 }
 
-double SearchServer::ComputeWordInverseDocumentFreq(std::string_view word) const {
-    return log(GetDocumentCount() * 1.0 / word_to_document_freqs_.at(word).size());
+uint32_t SearchServer::InternTerm(std::string_view word) {
+    const size_t term_count = term_dictionary_.size();
+    const uint32_t term_id = term_dictionary_.Intern(word);
+    if (term_id == term_count) {
+        term_index_.Add(term_dictionary_, term_id);
+    }
+    return term_id;
+}
+
+const PostingList *SearchServer::FindPostings(std::string_view word) const {
+    const uint32_t term_id = term_dictionary_.Find(word);
+    if (term_id == TermDictionary::NO_TERM || term_postings_[term_id].empty()) {
+        return nullptr;
+    }
+    return &term_postings_[term_id];
+}
+
+bool SearchServer::RemovePostings(uint32_t term_id, size_t removed_count) {
+    auto &postings = term_postings_[term_id];
+    postings.MarkRemoved(removed_count);
+    // Rebuilding only when removed postings outnumber the rest keeps the cost amortized constant per removal
+    if (postings.GetRemovedCount() <= postings.size()) {
+        return postings.empty();
+    }
+    PostingList rebuilt;
+    std::vector<uint32_t> positions;
+    for (PostingCursor cursor(postings); !cursor.IsEnd(); cursor.Next()) {
+        if (ordinal_to_document_id_[cursor.GetOrdinal()] != REMOVED_DOCUMENT_ID) {
+            cursor.GetPositions(positions);
+            rebuilt.Add(cursor.GetOrdinal(), cursor.GetCount(), GetTermFreq(cursor),
+                        postings.HasPositions() ? positions.data() : nullptr);
+        }
+    }
+    postings = std::move(rebuilt);
+    return postings.empty();
+}
+
+DocumentBitmap SearchServer::FindExcludedDocuments(const Query &query) const {
+    DocumentBitmap excluded;
+    for (const auto &word: query.minus_words) {
+        const PostingList *postings = FindPostings(word);
+        if (postings == nullptr) {
+            continue;
+        }
+        if (const DocumentBitmap *documents = postings->GetBitmap()) {
+            excluded = DocumentBitmap::Or(excluded, *documents);
+            continue;
+        }
+        DocumentBitmap documents;
+        for (PostingCursor cursor(*postings); !cursor.IsEnd(); cursor.Next()) {
+            documents.Add(cursor.GetOrdinal());
+        }
+        excluded = DocumentBitmap::Or(excluded, documents);
+    }
+    return excluded;
+}
+
+double SearchServer::GetAverageWordCount() const {
+    if (collection_statistics_ != nullptr) {
+        return static_cast<double>(collection_statistics_->GetWordCount()) /
+               static_cast<double>(collection_statistics_->GetDocumentCount());
+    }
+    return static_cast<double>(total_word_count_) / static_cast<double>(documents_.size());
+}
+
+ScoreAccumulator &SearchServer::GetThreadScoreAccumulator() {
+    static thread_local ScoreAccumulator accumulator;
+    return accumulator;
 }
 
 SearchServer::QueryWord SearchServer::ParseQueryWord(std::string_view text) const {
@@ -190,26 +468,48 @@ SearchServer::QueryWord SearchServer::ParseQueryWord(std::string_view text) cons
         is_minus = true;
         word = word.substr(1);
     }
-    if (word.empty() || word[0] == '-' || !IsValidWord(word)) {
+    if (word.empty() || word[0] == '-') {
         throw std::invalid_argument("Query word is invalid");
     }
+    if (word[0] == '*') {
+        throw std::invalid_argument("Wildcard needs a prefix"s);
+    }
 
-    return {word, is_minus, IsStopWord(word)};
+    return {word, is_minus, IsStopWord(word), word.find('*') != std::string_view::npos};
 }
 
-SearchServer::Query SearchServer::ParseQuery(std::string_view text) const {
-    Query result;
-    for (const auto &word: SplitIntoWordsStrView(text)) {
-        const auto query_word = ParseQueryWord(word);
-        if (!query_word.is_stop) {
-            if (query_word.is_minus) {
-                result.minus_words.push_back(query_word.data);
-            } else {
-                result.plus_words.push_back(query_word.data);
-            }
-        }
+void SearchServer::ExpandWildcard(std::string_view pattern, std::vector<std::string_view> &words) const {
+    // Terms a part of the collection lacks get no postings here, but they still take their place in the cap
+    if (collection_statistics_ != nullptr) {
+        collection_statistics_->ExpandWildcard(pattern, MAX_WILDCARD_TERM_COUNT, words);
+        return;
     }
+    term_index_.ExpandWildcard(term_dictionary_, pattern, MAX_WILDCARD_TERM_COUNT, [this](uint32_t term_id) {
+        return term_postings_[term_id].size();
+    }, words);
+}
 
+bool SearchServer::ParsePhraseEnd(std::string_view &word, Phrase &phrase) {
+    const size_t quote = word.find('"');
+    if (quote == std::string_view::npos) {
+        return false;
+    }
+    const std::string_view slop = word.substr(quote + 1);
+    word = word.substr(0, quote);
+    if (slop.empty()) {
+        return true;
+    }
+    // Up to 9 digits cannot overflow the slop
+    if (slop[0] != '~' || slop.size() < 2 || slop.size() > 10 ||
+        !std::all_of(slop.begin() + 1, slop.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+        throw std::invalid_argument("Phrase is invalid"s);
+    }
+    phrase.slop = static_cast<uint32_t>(std::stoul(std::string(slop.substr(1))));
+    return true;
+}
+
+SearchServer::Query SearchServer::ParseQuery(std::string_view text) const {
+    Query result = ParseQuery(std::execution::par, text);
 
     std::sort(result.plus_words.begin(), result.plus_words.end());
     std::sort(result.minus_words.begin(), result.minus_words.end());
@@ -223,57 +523,204 @@ SearchServer::Query SearchServer::ParseQuery(std::string_view text) const {
     return result;
 }
 
+std::string SearchServer::MakeQueryCacheKey(const Query &query, std::string_view scorer_name, DocumentStatus status,
+                                           size_t result_limit) {
+    // Words cannot contain spaces, and plus words cannot start with a minus
+    std::string key = std::string(scorer_name) + ' ' + std::to_string(static_cast<int>(status)) + ' ' +
+                      std::to_string(result_limit) + ' ';
+    for (const auto &word: query.plus_words) {
+        key += word;
+        key += ' ';
+    }
+    for (const auto &word: query.minus_words) {
+        key += '-';
+        key += word;
+        key += ' ';
+    }
+    // Phrase words cannot contain quotes
+    for (const auto &phrase: query.phrases) {
+        key += '"';
+        for (const auto &word: phrase.words) {
+            key += word;
+            key += ' ';
+        }
+        key += "\"~"s + std::to_string(phrase.slop) + ' ';
+    }
+    return key;
+}
+
 SearchServer::Query SearchServer::ParseQuery(const std::execution::parallel_policy &, std::string_view text) const {
     Query result;
-    for (const auto &word: SplitIntoWordsStrView(text)) {
+    static thread_local std::vector<std::string_view> words;
+    if (!SplitIntoValidWords(text, words)) {
+        throw std::invalid_argument("Query word is invalid");
+    }
+    bool is_in_phrase = false;
+    for (std::string_view word: words) {
+        if (word.size() > 1 && word[0] == '-' && word[1] == '"') {
+            throw std::invalid_argument("Minus phrases are not supported"s);
+        }
+        if (!is_in_phrase && word[0] == '"') {
+            is_in_phrase = true;
+            result.phrases.emplace_back();
+            word.remove_prefix(1);
+        }
+        if (is_in_phrase) {
+            auto &phrase = result.phrases.back();
+            const bool is_phrase_end = ParsePhraseEnd(word, phrase);
+            if (!word.empty()) {
+                const auto query_word = ParseQueryWord(word);
+                if (query_word.is_minus || query_word.is_wildcard) {
+                    throw std::invalid_argument("Phrase word is invalid"s);
+                }
+                // Positions skip stop words, so they are left out of phrases as well
+                if (!query_word.is_stop) {
+                    phrase.words.push_back(query_word.data);
+                    result.plus_words.push_back(query_word.data);
+                }
+            }
+            if (is_phrase_end) {
+                is_in_phrase = false;
+                if (phrase.words.empty()) {
+                    result.phrases.pop_back();
+                }
+            }
+            continue;
+        }
+
         const auto query_word = ParseQueryWord(word);
         if (!query_word.is_stop) {
-            if (query_word.is_minus) {
-                result.minus_words.push_back(query_word.data);
+            auto &words = query_word.is_minus ? result.minus_words : result.plus_words;
+            if (query_word.is_wildcard) {
+                ExpandWildcard(query_word.data, words);
             } else {
-                result.plus_words.push_back(query_word.data);
+                words.push_back(query_word.data);
             }
         }
     }
+    if (is_in_phrase) {
+        throw std::invalid_argument("Phrase is not closed"s);
+    }
+    if (!result.phrases.empty() && !has_positions_) {
+        throw std::invalid_argument("Phrase queries need the positional index"s);
+    }
 
     return result;
 }
 
-const std::map<std::string_view, double> &SearchServer::GetWordFrequencies(int document_id) const {
-
-    static std::map<std::string_view, double> word_freq;
-
-    if (!docId_to_word_freq_.count(document_id)) return word_freq;
-
-    word_freq = docId_to_word_freq_.at(document_id);
-
-    return word_freq;
+SearchServer::PhraseMatcher::PhraseMatcher(const SearchServer &server, const std::vector<Phrase> &phrases) {
+    std::vector<std::pair<uint32_t, const PostingList *>> terms;
+    for (const auto &phrase: phrases) {
+        for (const auto &word: phrase.words) {
+            const uint32_t term_id = server.term_dictionary_.Find(word);
+            if (term_id == TermDictionary::NO_TERM || server.term_postings_[term_id].empty()) {
+                is_empty_ = true;
+                return;
+            }
+            terms.emplace_back(term_id, &server.term_postings_[term_id]);
+        }
+    }
+    std::sort(terms.begin(), terms.end());
+    terms.erase(std::unique(terms.begin(), terms.end()), terms.end());
+    // The rarest list proposes candidates, the others only skip to them
+    std::stable_sort(terms.begin(), terms.end(), [](const auto &lhs, const auto &rhs) {
+        return lhs.second->size() < rhs.second->size();
+    });
+    for (const auto &[term_id, postings]: terms) {
+        cursors_.emplace_back(*postings);
+    }
+    positions_.resize(cursors_.size());
+
+    for (const auto &phrase: phrases) {
+        auto &word_cursors = phrase_cursors_.emplace_back();
+        for (const auto &word: phrase.words) {
+            const uint32_t term_id = server.term_dictionary_.Find(word);
+            word_cursors.push_back(std::find_if(terms.begin(), terms.end(), [term_id](const auto &term) {
+                return term.first == term_id;
+            }) - terms.begin());
+        }
+        slops_.push_back(phrase.slop);
+    }
 }
 
-std::list<std::string_view> SearchServer::GetJustWords(int document_id) const {
-
-    std::list<std::string_view> words;
-
-    if (!docId_to_word_freq_.count(document_id)) return words;
+uint32_t SearchServer::PhraseMatcher::FindNext(uint32_t ordinal) {
+    if (is_empty_ || cursors_.empty()) {
+        return PostingCursor::END_ORDINAL;
+    }
+    while (ordinal != PostingCursor::END_ORDINAL) {
+        size_t i = 0;
+        for (; i < cursors_.size(); ++i) {
+            cursors_[i].AdvanceTo(ordinal);
+            if (cursors_[i].GetOrdinal() != ordinal) {
+                break;
+            }
+        }
+        if (i < cursors_.size()) {
+            ordinal = cursors_[i].GetOrdinal();
+        } else if (ContainsPhrases()) {
+            return ordinal;
+        } else {
+            ++ordinal;
+        }
+    }
+    return PostingCursor::END_ORDINAL;
+}
 
-    std::for_each(std::execution::par, docId_to_word_freq_.at(document_id).begin(),
-                  docId_to_word_freq_.at(document_id).end(), [&words](const auto &elem) {
-                words.push_back(elem.first);
-            });
+bool SearchServer::PhraseMatcher::ContainsPhrases() {
+    for (size_t i = 0; i < cursors_.size(); ++i) {
+        cursors_[i].GetPositions(positions_[i]);
+    }
+    std::vector<const std::vector<uint32_t> *> word_positions;
+    for (size_t phrase = 0; phrase < phrase_cursors_.size(); ++phrase) {
+        word_positions.clear();
+        for (const size_t cursor: phrase_cursors_[phrase]) {
+            word_positions.push_back(&positions_[cursor]);
+        }
+        if (!ContainsPhrase(word_positions, slops_[phrase])) {
+            return false;
+        }
+    }
+    return true;
+}
 
-    return words;
+WordFrequencies SearchServer::GetWordFrequencies(int document_id) const {
+    const auto document = documents_.find(document_id);
+    if (document == documents_.end()) {
+        return {};
+    }
+    return {term_dictionary_, GetDocumentTerms(document->second), document->second.term_count,
+            ordinal_to_inv_word_count_[document->second.ordinal]};
+}
 
+DocumentWords SearchServer::GetJustWords(int document_id) const {
+    const auto document = documents_.find(document_id);
+    if (document == documents_.end()) {
+        return {};
+    }
+    return {term_dictionary_, GetDocumentTerms(document->second), document->second.term_count, 0.0};
 }
 
 void SearchServer::RemoveDocument(const std::execution::sequenced_policy &, int document_id) {
 
-    for (auto &[str, freq]: GetWordFrequencies(document_id)) {
-        word_to_document_freqs_.at(str).erase(document_id);
+    const auto document = documents_.find(document_id);
+    if (document == documents_.end()) {
+        return;
+    }
+
+    ordinal_to_document_id_.Mutable()[document->second.ordinal] = REMOVED_DOCUMENT_ID;
+    ordinal_to_status_.Mutable()[document->second.ordinal] = REMOVED_DOCUMENT_STATUS;
+    const DocumentTerm *terms = GetDocumentTerms(document->second);
+    for (size_t i = 0; i < document->second.term_count; ++i) {
+        emptied_term_count_ += RemovePostings(terms[i].term_id, 1);
     }
+    removed_term_count_ += document->second.term_count;
+    total_word_count_ -= ordinal_to_word_count_[document->second.ordinal];
 
-    docId_to_word_freq_.erase(document_id);
     document_ids_.erase(document_id);
-    documents_.erase(document_id);
+    ReleaseText(document->second.text);
+    documents_.erase(document);
+    ++generation_;
+    CollectGarbage();
 }
 
 void SearchServer::RemoveDocument(const std::execution::parallel_policy &par, int document_id) {
@@ -282,34 +729,259 @@ void SearchServer::RemoveDocument(const std::execution::parallel_policy &par, in
         throw std::invalid_argument("Invalid document ID to remove"s);
     }
 
-    std::map<std::string_view, double> word_freqs = docId_to_word_freq_.at(document_id);
-    std::vector<const std::string_view *> words_to_erase(word_freqs.size());
+    const auto document = documents_.find(document_id);
+    ordinal_to_document_id_.Mutable()[document->second.ordinal] = REMOVED_DOCUMENT_ID;
+    ordinal_to_status_.Mutable()[document->second.ordinal] = REMOVED_DOCUMENT_STATUS;
+    const DocumentTerm *terms = GetDocumentTerms(document->second);
+    // Every term has its own posting list, so the lists are changed independently
+    emptied_term_count_ += std::count_if(std::execution::par, terms, terms + document->second.term_count,
+                                         [this](const DocumentTerm &term) {
+                                             return RemovePostings(term.term_id, 1);
+                                         });
+    removed_term_count_ += document->second.term_count;
+    total_word_count_ -= ordinal_to_word_count_[document->second.ordinal];
+
+    ReleaseText(document->second.text);
+    documents_.erase(document);
+    document_ids_.erase(document_id);
+    ++generation_;
+    CollectGarbage();
+}
 
-    std::transform(std::execution::par, word_freqs.begin(), word_freqs.end(),
-                   words_to_erase.begin(),
-                   [](const auto &words_freq) { return &words_freq.first; });
+void SearchServer::RemoveDocument(int document_id) {
+    RemoveDocument(std::execution::seq, document_id);
+}
 
-    std::for_each(std::execution::par, words_to_erase.begin(), words_to_erase.end(),
-                  [this, document_id](const auto &word) { word_to_document_freqs_.at(*word).erase(document_id); });
+void SearchServer::RemoveDocuments(const std::vector<int> &document_ids) {
+    RemoveDocuments(std::execution::par, document_ids);
+}
 
-    documents_.erase(document_id);
-    document_ids_.erase(document_id);
-    docId_to_word_freq_.erase(document_id);
+void SearchServer::RemoveDocuments(const std::execution::sequenced_policy &, const std::vector<int> &document_ids) {
+    RemoveDocumentsImpl(std::execution::seq, document_ids);
 }
 
-void SearchServer::RemoveDocument(int document_id) {
+void SearchServer::RemoveDocuments(const std::execution::parallel_policy &, const std::vector<int> &document_ids) {
+    RemoveDocumentsImpl(std::execution::par, document_ids);
+}
 
+template<typename ExecutionPolicy>
+void SearchServer::RemoveDocumentsImpl(const ExecutionPolicy &executionPolicy, const std::vector<int> &document_ids) {
+    std::vector<uint32_t> term_ids;
+    bool is_removed = false;
+    for (const int document_id: document_ids) {
+        const auto document = documents_.find(document_id);
+        if (document == documents_.end()) {
+            continue;
+        }
+        ordinal_to_document_id_.Mutable()[document->second.ordinal] = REMOVED_DOCUMENT_ID;
+        ordinal_to_status_.Mutable()[document->second.ordinal] = REMOVED_DOCUMENT_STATUS;
+        const DocumentTerm *terms = GetDocumentTerms(document->second);
+        for (size_t i = 0; i < document->second.term_count; ++i) {
+            term_ids.push_back(terms[i].term_id);
+        }
+        removed_term_count_ += document->second.term_count;
+        total_word_count_ -= ordinal_to_word_count_[document->second.ordinal];
+        document_ids_.erase(document_id);
+        ReleaseText(document->second.text);
+        documents_.erase(document);
+        is_removed = true;
+    }
+    if (!is_removed) {
+        return;
+    }
 
-    for (auto &[word, idAndFreq]: word_to_document_freqs_) {
-        if (idAndFreq.count(document_id)) {
-            idAndFreq.erase(document_id);
+    // Grouped by term, every posting list is marked and checked for a rebuild once per batch
+    std::sort(executionPolicy, term_ids.begin(), term_ids.end());
+    std::vector<size_t> run_begins;
+    for (size_t i = 0; i < term_ids.size(); ++i) {
+        if (i == 0 || term_ids[i] != term_ids[i - 1]) {
+            run_begins.push_back(i);
         }
     }
+    emptied_term_count_ += std::count_if(executionPolicy, run_begins.begin(), run_begins.end(), [&](size_t begin) {
+        const auto run_end = std::upper_bound(term_ids.begin() + begin, term_ids.end(), term_ids[begin]);
+        return RemovePostings(term_ids[begin], run_end - term_ids.begin() - begin);
+    });
+    ++generation_;
+    CollectGarbage();
+}
 
-    document_ids_.erase(document_id);
-    docId_to_word_freq_.erase(document_id);
-    documents_.erase(document_id);
+void SearchServer::CompactTexts() {
+    TextArena compacted;
+    for (auto &[document_id, document_data]: documents_) {
+        if (!IsMappedText(document_data.text)) {
+            document_data.text = compacted.Append(document_data.text);
+        }
+    }
+    text_arena_ = std::move(compacted);
+}
+
+bool SearchServer::IsMappedText(std::string_view text) const {
+    return snapshot_file_ != nullptr && text.data() >= snapshot_file_->data() &&
+           text.data() < snapshot_file_->data() + snapshot_file_->size();
+}
+
+void SearchServer::ReleaseText(std::string_view text) {
+    if (IsMappedText(text)) {
+        return;
+    }
+    text_arena_.Release(text);
+}
+
+void SearchServer::CollectGarbage() {
+    if (text_arena_.NeedsCompaction()) {
+        CompactTexts();
+    }
+    if (removed_term_count_ > forward_index_.size() - removed_term_count_) {
+        CompactForwardIndex();
+    }
+    // Cleaning the dictionary once emptied terms may make up half of it keeps the cost amortized constant
+    if (emptied_term_count_ * 2 > term_postings_.size()) {
+        RemoveEmptyTerms();
+    }
+}
 
+void SearchServer::CompactForwardIndex() {
+    std::vector<DocumentTerm> compacted;
+    compacted.reserve(forward_index_.size() - removed_term_count_);
+    for (auto &[document_id, document_data]: documents_) {
+        const DocumentTerm *terms = GetDocumentTerms(document_data);
+        document_data.first_term = compacted.size();
+        compacted.insert(compacted.end(), terms, terms + document_data.term_count);
+    }
+    forward_index_ = MappedArray<DocumentTerm>();
+    forward_index_.Mutable() = std::move(compacted);
+    removed_term_count_ = 0;
 }
 
+void SearchServer::RemoveEmptyTerms() {
+    TermDictionary term_dictionary;
+    std::vector<PostingList> term_postings;
+    std::vector<uint32_t> new_term_ids(term_postings_.size(), TermDictionary::NO_TERM);
+    for (uint32_t term_id = 0; term_id < term_postings_.size(); ++term_id) {
+        if (!term_postings_[term_id].empty()) {
+            new_term_ids[term_id] = term_dictionary.Intern(term_dictionary_.GetTerm(term_id));
+            term_postings.push_back(std::move(term_postings_[term_id]));
+        }
+    }
+    // Kept terms are renumbered in the same order, so the terms of every document stay sorted.
+    // Terms of removed documents may become NO_TERM, nothing else reads them.
+    for (auto &term: forward_index_.Mutable()) {
+        if (term.term_id != TermDictionary::NO_TERM) {
+            term.term_id = new_term_ids[term.term_id];
+        }
+    }
+    term_index_.Remap(new_term_ids);
+    term_dictionary_ = std::move(term_dictionary);
+    term_postings_ = std::move(term_postings);
+    emptied_term_count_ = 0;
+}
 
+void SearchServer::SaveSnapshot(const std::string &path) const {
+    SnapshotWriter writer(path);
+
+    std::string stop_words;
+    for (const auto &word: stop_words_) {
+        stop_words += word;
+        stop_words += ' ';
+    }
+    writer.WriteString(stop_words);
+    writer.WriteValue<uint8_t>(has_positions_);
+
+    term_dictionary_.Save(writer);
+    term_index_.Save(term_dictionary_, writer);
+    writer.WriteArray(ordinal_to_document_id_.data(), ordinal_to_document_id_.size());
+    writer.WriteArray(ordinal_to_inv_word_count_.data(), ordinal_to_inv_word_count_.size());
+    writer.WriteArray(ordinal_to_word_count_.data(), ordinal_to_word_count_.size());
+    writer.WriteArray(ordinal_to_rating_.data(), ordinal_to_rating_.size());
+    writer.WriteArray(ordinal_to_status_.data(), ordinal_to_status_.size());
+
+    // Terms of removed documents are left out of the forward index
+    std::vector<SnapshotDocument> documents;
+    std::vector<DocumentTerm> forward_index;
+    std::string texts;
+    documents.reserve(documents_.size());
+    forward_index.reserve(forward_index_.size() - removed_term_count_);
+    for (const auto &[document_id, document_data]: documents_) {
+        const DocumentTerm *terms = GetDocumentTerms(document_data);
+        documents.push_back({document_id, document_data.ordinal, texts.size(), document_data.text.size(),
+                             forward_index.size(), document_data.term_count});
+        texts += document_data.text;
+        forward_index.insert(forward_index.end(), terms, terms + document_data.term_count);
+    }
+    writer.WriteArray(documents.data(), documents.size());
+    writer.WriteString(texts);
+    writer.WriteArray(forward_index.data(), forward_index.size());
+
+    writer.WriteValue<uint64_t>(term_postings_.size());
+    for (const auto &postings: term_postings_) {
+        postings.Save(writer);
+    }
+    writer.Finish();
+}
+
+SearchServer SearchServer::OpenSnapshot(const std::string &path, bool verify_checksum) {
+    auto file = std::make_shared<const MappedFile>(path);
+    SnapshotReader reader(*file, verify_checksum);
+
+    SearchServer server(std::string(reader.ReadString()));
+    server.snapshot_file_ = file;
+    server.has_positions_ = reader.ReadValue<uint8_t>() != 0;
+    server.term_dictionary_ = TermDictionary::Load(reader);
+    server.term_index_ = TermIndex::Load(server.term_dictionary_, reader);
+    server.ordinal_to_document_id_ = reader.ReadArray<int>();
+    server.ordinal_to_inv_word_count_ = reader.ReadArray<double>();
+    server.ordinal_to_word_count_ = reader.ReadArray<uint32_t>();
+    server.ordinal_to_rating_ = reader.ReadArray<int>();
+    server.ordinal_to_status_ = reader.ReadArray<DocumentStatus>();
+    const size_t ordinal_count = server.ordinal_to_document_id_.size();
+    if (server.ordinal_to_inv_word_count_.size() != ordinal_count ||
+        server.ordinal_to_word_count_.size() != ordinal_count || server.ordinal_to_rating_.size() != ordinal_count ||
+        server.ordinal_to_status_.size() != ordinal_count) {
+        SnapshotReader::ThrowCorrupted();
+    }
+    // Status filters rely on removed documents, and only them, having the removed status
+    for (size_t ordinal = 0; ordinal < ordinal_count; ++ordinal) {
+        const DocumentStatus status = server.ordinal_to_status_[ordinal];
+        const bool is_removed = server.ordinal_to_document_id_[ordinal] == REMOVED_DOCUMENT_ID;
+        if (is_removed ? status != REMOVED_DOCUMENT_STATUS
+                       : status < DocumentStatus::ACTUAL || status > DocumentStatus::REMOVED) {
+            SnapshotReader::ThrowCorrupted();
+        }
+    }
+
+    // Records are sorted by document id, so the maps are filled by appending
+    const auto documents = reader.ReadArray<SnapshotDocument>();
+    const std::string_view texts = reader.ReadString();
+    server.forward_index_ = reader.ReadArray<DocumentTerm>();
+    const size_t forward_index_size = server.forward_index_.size();
+    for (const auto &term: server.forward_index_) {
+        if (term.term_id >= server.term_dictionary_.size()) {
+            SnapshotReader::ThrowCorrupted();
+        }
+    }
+    for (const auto &document: documents) {
+        if (document.ordinal >= ordinal_count || server.ordinal_to_document_id_[document.ordinal] != document.id ||
+            document.text_offset > texts.size() || document.text_size > texts.size() - document.text_offset ||
+            document.first_term > forward_index_size || document.term_count > forward_index_size - document.first_term) {
+            SnapshotReader::ThrowCorrupted();
+        }
+        server.documents_.emplace_hint(server.documents_.end(), document.id,
+                                       DocumentData{texts.substr(document.text_offset, document.text_size),
+                                                    document.ordinal, document.first_term,
+                                                    static_cast<uint32_t>(document.term_count)});
+        server.document_ids_.emplace_hint(server.document_ids_.end(), document.id);
+        server.total_word_count_ += server.ordinal_to_word_count_[document.ordinal];
+    }
+
+    const auto term_count = reader.ReadValue<uint64_t>();
+    if (term_count != server.term_dictionary_.size()) {
+        SnapshotReader::ThrowCorrupted();
+    }
+    server.term_postings_.reserve(term_count);
+    for (size_t i = 0; i < term_count; ++i) {
+        server.term_postings_.push_back(PostingList::Load(reader, ordinal_count));
+        server.emptied_term_count_ += server.term_postings_.back().empty();
+    }
+    return server;
+}
@@ -9,18 +9,52 @@
 #include <cmath>
 #include <execution>
 #include <deque>
-#include <list>
-#include "concurrent_map.h"
+#include <memory>
+#include <numeric>
+#include <thread>
+#include <type_traits>
+#include "collection_statistics.h"
+#include "document_bitmap.h"
+#include "forward_index.h"
+#include "posting_list.h"
+#include "query_cache.h"
+#include "query_executor.h"
+#include "score_accumulator.h"
+#include "scoring.h"
+#include "snapshot.h"
+#include "term_dictionary.h"
+#include "term_index.h"
+#include "text_arena.h"
+#include "top_documents_collector.h"
 
 
 using namespace std::string_literals;
 
 const int MAX_RESULT_DOCUMENT_COUNT = 5;
-constexpr float EPSILON = 1e-6;
+
+// A query word with * after a prefix, such as cat* or c*t, stands for at most this many of the most frequent
+// terms matching it
+const size_t MAX_WILDCARD_TERM_COUNT = 64;
+
+// Parallel search does not split the documents into ranges smaller than this
+const uint32_t MIN_PARALLEL_RANGE_SIZE = 4096;
+
+namespace search_policy {
+    // Sequential evaluation with Block-Max WAND dynamic pruning: documents whose score upper bound cannot
+    // get them into the result are skipped without being scored. Returns the same documents as seq.
+    struct block_max_wand_policy {
+    };
+
+    inline constexpr block_max_wand_policy block_max_wand;
+}
 
 class SearchServer {
 public:
-    std::map<int, std::map<std::string_view, double>> docId_to_word_freq_;
+    // Keeps the predicate overloads of FindTopDocuments from capturing an integer result_limit
+    template<typename DocumentPredicate>
+    using EnableIfPredicate = std::enable_if_t<
+            std::is_invocable_r_v<bool, DocumentPredicate, int, DocumentStatus, int>>;
+
     template<typename StringContainer>
     explicit SearchServer(const StringContainer &stop_words);
 
@@ -30,28 +64,69 @@ public:
     void AddDocument(int document_id, std::string_view document, DocumentStatus status,
                      const std::vector<int> &ratings);
 
-    template<typename DocumentPredicate, typename ExecutionPolicy>
+    // Adds a batch of documents: texts are tokenized and indexed in chunks in parallel, then the partial
+    // indexes are merged into the main one. Throws invalid_argument and adds nothing if any record is invalid.
+    void AddDocuments(const std::vector<DocumentInput> &documents);
+
+    void AddDocuments(const std::execution::sequenced_policy &, const std::vector<DocumentInput> &documents);
+
+    void AddDocuments(const std::execution::parallel_policy &, const std::vector<DocumentInput> &documents);
+
+    // Scorer is the relevance model from scoring.h, TF-IDF unless given: FindTopDocuments<scoring::Bm25>(...).
+    // result_limit is the maximum number of documents to return
+    template<typename Scorer = scoring::TfIdf, typename DocumentPredicate, typename ExecutionPolicy,
+            typename = EnableIfPredicate<DocumentPredicate>>
     [[nodiscard]] std::vector<Document> FindTopDocuments(ExecutionPolicy &executionPolicy, std::string_view raw_query,
-                                                         DocumentPredicate document_predicate) const;
+                                                         DocumentPredicate document_predicate,
+                                                         size_t result_limit = MAX_RESULT_DOCUMENT_COUNT) const;
 
-    template<typename DocumentPredicate>
+    template<typename Scorer = scoring::TfIdf, typename DocumentPredicate,
+            typename = EnableIfPredicate<DocumentPredicate>>
     [[nodiscard]] std::vector<Document> FindTopDocuments(std::string_view raw_query,
-                                                         DocumentPredicate document_predicate) const;
+                                                         DocumentPredicate document_predicate,
+                                                         size_t result_limit = MAX_RESULT_DOCUMENT_COUNT) const;
 
-    template<typename ExecutionPolicy>
+    template<typename Scorer = scoring::TfIdf, typename ExecutionPolicy>
     [[nodiscard]] std::vector<Document>
-    FindTopDocuments(ExecutionPolicy &executionPolicy, std::string_view raw_query, DocumentStatus status) const;
+    FindTopDocuments(ExecutionPolicy &executionPolicy, std::string_view raw_query, DocumentStatus status,
+                     size_t result_limit = MAX_RESULT_DOCUMENT_COUNT) const;
 
-    [[nodiscard]] std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status) const;
+    template<typename Scorer = scoring::TfIdf>
+    [[nodiscard]] std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status,
+                                                         size_t result_limit = MAX_RESULT_DOCUMENT_COUNT) const;
 
-    template<typename ExecutionPolicy>
+    template<typename Scorer = scoring::TfIdf, typename ExecutionPolicy>
     [[nodiscard]] std::vector<Document>
-    FindTopDocuments(ExecutionPolicy &executionPolicy, std::string_view raw_query) const;
+    FindTopDocuments(ExecutionPolicy &executionPolicy, std::string_view raw_query,
+                     size_t result_limit = MAX_RESULT_DOCUMENT_COUNT) const;
 
-    [[nodiscard]] std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+    template<typename Scorer = scoring::TfIdf>
+    [[nodiscard]] std::vector<Document> FindTopDocuments(std::string_view raw_query,
+                                                         size_t result_limit = MAX_RESULT_DOCUMENT_COUNT) const;
 
     [[nodiscard]] int GetDocumentCount() const;
 
+    // Caches results of the FindTopDocuments overloads that filter by status; capacity is the total number
+    // of cached queries. Adding or removing documents invalidates the cache.
+    void EnableQueryCache(size_t capacity, size_t shard_count = 16);
+
+    [[nodiscard]] QueryCacheStats GetQueryCacheStats() const;
+
+    // Stores the positions of words in documents, which phrase queries need: "white cat" matches the words
+    // in a row, "white cat"~2 allows up to two other words between neighbours. Positions count words that
+    // are not stop words. Existing documents are indexed again from their stored texts.
+    void EnablePositionalIndex();
+
+    [[nodiscard]] bool HasPositionalIndex() const {
+        return has_positions_;
+    }
+
+    // Makes relevance use the document frequencies of a collection this server holds a part of, so results
+    // of several servers can be merged. The statistics must outlive the server; nullptr restores local ones.
+    void SetCollectionStatistics(const CollectionStatistics *statistics);
+
+    // Words matched by wildcards view the dictionary, or the collection statistics if set, so adding documents
+    // invalidates them
     [[nodiscard]] std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(std::string_view raw_query,
                                                                                           int document_id) const;
 
@@ -71,9 +146,11 @@ public:
         return document_ids_.end();
     }
 
-    [[nodiscard]] const std::map<std::string_view, double> &GetWordFrequencies(int document_id) const;
+    // Views of the words of the document in term id order, empty if there is no such document.
+    // Any change of the server invalidates them.
+    [[nodiscard]] WordFrequencies GetWordFrequencies(int document_id) const;
 
-    [[nodiscard]] std::list<std::string_view> GetJustWords(int document_id) const;
+    [[nodiscard]] DocumentWords GetJustWords(int document_id) const;
 
     void RemoveDocument(const std::execution::sequenced_policy &, int document_id);
 
@@ -81,184 +158,587 @@ public:
 
     void RemoveDocument(int document_id);
 
+    // Removes a batch of documents, marking the postings of every term at once; unknown ids are skipped
+    void RemoveDocuments(const std::vector<int> &document_ids);
+
+    void RemoveDocuments(const std::execution::sequenced_policy &, const std::vector<int> &document_ids);
+
+    void RemoveDocuments(const std::execution::parallel_policy &, const std::vector<int> &document_ids);
+
+    // Moves the stored texts of the documents together and frees the memory of removed ones. Invalidates the
+    // word views returned earlier; RemoveDocument calls it once removed texts outweigh the live ones.
+    void CompactTexts();
+
+    // Writes the index and the stored texts to a binary image for OpenSnapshot
+    void SaveSnapshot(const std::string &path) const;
+
+    // Maps a snapshot and serves queries from it without rebuilding the index; the mapped data is copied only
+    // when the server is modified. Without checksum verification a damaged file may go unnoticed.
+    // Throws runtime_error if the file is not a valid snapshot.
+    static SearchServer OpenSnapshot(const std::string &path, bool verify_checksum = true);
+
 
 private:
+    // Rating and status are kept in the ordinal columns
     struct DocumentData {
-        int rating;
-        DocumentStatus status;
-        std::string data;
+        // Points into text_arena_ or, for documents opened from a snapshot, into the mapped file
+        std::string_view text;
+        uint32_t ordinal;
+        // Terms of the document in forward_index_
+        size_t first_term;
+        uint32_t term_count;
     };
+    // Stored in ordinal_to_document_id_ for removed documents, whose postings stay until their lists are rebuilt
+    static constexpr int REMOVED_DOCUMENT_ID = -1;
+    // Stored in ordinal_to_status_ for removed documents, so filtering by status skips them with the same comparison
+    static constexpr auto REMOVED_DOCUMENT_STATUS = static_cast<DocumentStatus>(-1);
+
     const std::set<std::string, std::less<>> stop_words_;
-    std::map<std::string_view, std::map<int, double>> word_to_document_freqs_;
+    TermDictionary term_dictionary_;
+    TermIndex term_index_;
+    std::vector<PostingList> term_postings_;
+    MappedArray<DocumentTerm> forward_index_;
+    // Terms of removed documents stay in the forward index until it is compacted
+    size_t removed_term_count_ = 0;
+    MappedArray<int> ordinal_to_document_id_;
+    MappedArray<double> ordinal_to_inv_word_count_;
+    MappedArray<uint32_t> ordinal_to_word_count_;
+    // Dense columns for the evaluation loops, which never look documents up in documents_
+    MappedArray<int> ordinal_to_rating_;
+    MappedArray<DocumentStatus> ordinal_to_status_;
+    // Words of the documents that are not removed, for the average document length
+    uint64_t total_word_count_ = 0;
+    TextArena text_arena_;
     std::map<int, DocumentData> documents_;
     std::set<int> document_ids_;
+    // Keeps the mapped snapshot alive while any array or text refers to it
+    std::shared_ptr<const MappedFile> snapshot_file_;
+    std::unique_ptr<QueryResultCache> query_cache_;
+    const CollectionStatistics *collection_statistics_ = nullptr;
+    // Incremented by every change of the index
+    uint64_t generation_ = 0;
+    bool has_positions_ = false;
+    // Terms with empty posting lists, which the dictionary keeps until it is cleaned
+    size_t emptied_term_count_ = 0;
 
 
     [[nodiscard]] bool IsStopWord(const std::string_view word) const;
 
     static bool IsValidWord(std::string_view word);
 
-    std::vector<std::string_view> SplitIntoWordsNoStop(const std::string_view text) const;
+    // Throws invalid_argument if the text contains control characters
+    void SplitIntoWordsNoStop(std::string_view text, std::vector<std::string_view> &words) const;
 
     static int ComputeAverageRating(const std::vector<int> &ratings);
 
+    // Interns the word, adding a new term to the term index as well
+    uint32_t InternTerm(std::string_view word);
+
+    [[nodiscard]] bool IsMappedText(std::string_view text) const;
+
+    // Texts of removed documents are dead bytes of the arena until it is compacted
+    void ReleaseText(std::string_view text);
+
+    // Compacts the texts and the forward index and drops terms without postings once any of it pays off;
+    // called after removals
+    void CollectGarbage();
+
+    void CompactForwardIndex();
+
+    // Rebuilds the dictionary without the terms that no document contains
+    void RemoveEmptyTerms();
+
+    [[nodiscard]] const DocumentTerm *GetDocumentTerms(const DocumentData &document) const {
+        return forward_index_.data() + document.first_term;
+    }
+
+    template<typename ExecutionPolicy>
+    void RemoveDocumentsImpl(const ExecutionPolicy &executionPolicy, const std::vector<int> &document_ids);
+
+    template<typename ExecutionPolicy>
+    void AddDocumentsImpl(const ExecutionPolicy &executionPolicy, const std::vector<DocumentInput> &documents,
+                          size_t chunk_count);
+
     struct QueryWord {
         std::string_view data;
         bool is_minus;
         bool is_stop;
+        bool is_wildcard;
     };
 
+    // Throws invalid_argument if the word is empty, has extra minuses or is a wildcard without a prefix
     [[nodiscard]] QueryWord ParseQueryWord(std::string_view text) const;
 
+    // Appends the terms matching the pattern that some document contains, keeping the most frequent ones.
+    // With collection statistics the terms and frequencies are those of the whole collection, so all parts
+    // expand a wildcard alike.
+    void ExpandWildcard(std::string_view pattern, std::vector<std::string_view> &words) const;
+
+    // Words of a quoted phrase in query order; every next word may follow the previous one with up to slop
+    // other words between them
+    struct Phrase {
+        std::vector<std::string_view> words;
+        uint32_t slop = 0;
+    };
+
+    // Phrase words are plus words too: a document must contain every phrase and is scored by all plus words
     struct Query {
         std::vector<std::string_view> plus_words;
         std::vector<std::string_view> minus_words;
+        std::vector<Phrase> phrases;
     };
 
+    // Strips the closing quote and the optional ~slop from the last word of a phrase.
+    // Returns false if the word does not close the phrase.
+    static bool ParsePhraseEnd(std::string_view &word, Phrase &phrase);
+
     [[nodiscard]] Query ParseQuery(std::string_view text) const;
 
     [[nodiscard]] Query ParseQuery(const std::execution::parallel_policy &, std::string_view text) const;
 
-    [[nodiscard]] double ComputeWordInverseDocumentFreq(std::string_view word) const;
+    // Appends the words the document contains to matched_words. Sorted term ids of the words are looked up
+    // from the last found position, which merges them with the terms of the document.
+    void FindDocumentWords(const DocumentData &document, const std::vector<std::string_view> &words,
+                           std::vector<std::string_view> &matched_words) const;
+
+    [[nodiscard]] std::tuple<std::vector<std::string_view>, DocumentStatus> MatchQuery(const Query &query,
+                                                                                       int document_id) const;
+
+    // Encodes the normalized query, so differently ordered or repeated words give the same key
+    static std::string MakeQueryCacheKey(const Query &query, std::string_view scorer_name, DocumentStatus status,
+                                         size_t result_limit);
+
+    // Finds the documents containing every phrase of a query. The posting lists of the phrase words are
+    // intersected rarest first, skipping ahead with galloping search, and positions are decoded only for
+    // documents of the intersection.
+    class PhraseMatcher {
+    public:
+        PhraseMatcher(const SearchServer &server, const std::vector<Phrase> &phrases);
+
+        // First ordinal not less than the given one whose document contains the phrases, END_ORDINAL if none.
+        // Ordinals have to be asked in increasing order; removed documents are not skipped.
+        [[nodiscard]] uint32_t FindNext(uint32_t ordinal);
+
+    private:
+        // Cursors over the distinct phrase words, rarest first, and the positions of the current document
+        std::vector<PostingCursor> cursors_;
+        std::vector<std::vector<uint32_t>> positions_;
+        // Indexes of the cursors of the words of every phrase
+        std::vector<std::vector<size_t>> phrase_cursors_;
+        std::vector<uint32_t> slops_;
+        // Some phrase word is in no document
+        bool is_empty_ = false;
+
+        [[nodiscard]] bool ContainsPhrases();
+    };
 
-    template<typename DocumentPredicate>
-    [[nodiscard]] std::vector<Document> FindAllDocuments(const Query &query,
-                                                         DocumentPredicate document_predicate) const;
+    // Phrases usually leave few documents, so all policies walk the intersection sequentially
+    template<typename Scorer, typename DocumentFilter>
+    void FindPhraseDocuments(const Query &query, const Scorer &scorer, DocumentFilter document_filter,
+                             TopDocumentsCollector &collector) const;
 
-    template<typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(const std::execution::sequenced_policy &executionPolicy, const Query &query,
-                                           DocumentPredicate document_predicate) const;
+    template<typename Scorer, typename DocumentFilter, typename ExecutionPolicy>
+    [[nodiscard]] std::vector<Document>
+    FindTopDocumentsForQuery(ExecutionPolicy &executionPolicy, const Query &query,
+                             DocumentFilter document_filter, size_t result_limit) const;
+
+    // Returns nullptr if no document that is not removed contains the word
+    [[nodiscard]] const PostingList *FindPostings(std::string_view word) const;
+
+    // Marks postings of removed documents in the list of the term, rebuilding the list once it is mostly
+    // removed postings. Returns true if no document that is not removed contains the term.
+    bool RemovePostings(uint32_t term_id, size_t removed_count);
+
+    // Documents containing any of the minus words. Evaluation collects them before scoring and skips them while
+    // traversing the plus words; bitmaps of frequent words are merged without decoding their postings.
+    [[nodiscard]] DocumentBitmap FindExcludedDocuments(const Query &query) const;
+
+    // Uses the collection statistics, if set
+    template<typename Scorer>
+    [[nodiscard]] double ComputeWordInverseDocumentFreq(std::string_view word, const PostingList &postings) const;
+
+    [[nodiscard]] double GetAverageWordCount() const;
+
+    [[nodiscard]] double GetTermFreq(const PostingCursor &cursor) const {
+        return cursor.GetCount() * ordinal_to_inv_word_count_[cursor.GetOrdinal()];
+    }
+
+    // Scorers that do not use one of the document lengths let the compiler drop its load
+    template<typename Scorer>
+    [[nodiscard]] double ScoreTermFreq(const Scorer &scorer, const PostingCursor &cursor) const {
+        const uint32_t ordinal = cursor.GetOrdinal();
+        return scorer.ScoreTermFreq(cursor.GetCount(), ordinal_to_word_count_[ordinal],
+                                    ordinal_to_inv_word_count_[ordinal]);
+    }
+
+    // Document filters take the ordinal of a posting and accept the documents a query may return, never removed
+    // ones. Filtering by status reads only the status column, so it neither calls a predicate nor reads the ids.
+    [[nodiscard]] auto MakeStatusFilter(DocumentStatus status) const {
+        return [this, status](uint32_t ordinal) {
+            return ordinal_to_status_[ordinal] == status;
+        };
+    }
 
     template<typename DocumentPredicate>
-    std::vector<Document>
-    FindAllDocuments(const std::execution::parallel_policy &executionPolicy, const Query &query,
-                     DocumentPredicate document_predicate) const;
+    [[nodiscard]] auto MakePredicateFilter(DocumentPredicate document_predicate) const {
+        return [this, document_predicate](uint32_t ordinal) mutable {
+            const int document_id = ordinal_to_document_id_[ordinal];
+            return document_id != REMOVED_DOCUMENT_ID &&
+                   document_predicate(document_id, ordinal_to_status_[ordinal], ordinal_to_rating_[ordinal]);
+        };
+    }
+
+    // Scratch accumulator of the calling thread, reused by all sequential queries on that thread
+    static ScoreAccumulator &GetThreadScoreAccumulator();
+
+    template<typename Scorer, typename DocumentFilter>
+    void FindAllDocuments(const Query &query, const Scorer &scorer, DocumentFilter document_filter,
+                          TopDocumentsCollector &collector) const;
+
+    template<typename Scorer, typename DocumentFilter>
+    void FindAllDocuments(const std::execution::sequenced_policy &executionPolicy, const Query &query,
+                          const Scorer &scorer, DocumentFilter document_filter,
+                          TopDocumentsCollector &collector) const;
+
+    template<typename Scorer, typename DocumentFilter>
+    void FindAllDocuments(const std::execution::parallel_policy &executionPolicy, const Query &query,
+                          const Scorer &scorer, DocumentFilter document_filter,
+                          TopDocumentsCollector &collector) const;
+
+    template<typename Scorer, typename DocumentFilter>
+    void FindAllDocuments(QueryExecutor &executor, const Query &query, const Scorer &scorer,
+                          DocumentFilter document_filter, TopDocumentsCollector &collector) const;
+
+    template<typename Scorer, typename DocumentFilter>
+    void FindAllDocuments(const search_policy::block_max_wand_policy &, const Query &query, const Scorer &scorer,
+                          DocumentFilter document_filter, TopDocumentsCollector &collector) const;
+
+    // Scores ranges of document ordinals independently; for_each_range(range_count, function) has to call
+    // function(range) for every range, possibly in parallel
+    template<typename Scorer, typename DocumentFilter, typename ForEachRange>
+    void FindAllDocumentsInRanges(const Query &query, const Scorer &scorer, DocumentFilter document_filter,
+                                  TopDocumentsCollector &collector, size_t max_range_count,
+                                  ForEachRange for_each_range) const;
 };
 
-template<typename DocumentPredicate>
+template<typename Scorer, typename DocumentPredicate, typename>
 [[nodiscard]] std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query,
-                                                                   DocumentPredicate document_predicate) const {
-    return FindTopDocuments(std::execution::seq, raw_query, document_predicate);
+                                                                   DocumentPredicate document_predicate,
+                                                                   size_t result_limit) const {
+    return FindTopDocuments<Scorer>(std::execution::seq, raw_query, document_predicate, result_limit);
+}
+
+template<typename Scorer, typename DocumentPredicate, typename ExecutionPolicy, typename>
+[[nodiscard]] std::vector<Document>
+SearchServer::FindTopDocuments(ExecutionPolicy &executionPolicy, std::string_view raw_query,
+                               DocumentPredicate document_predicate, size_t result_limit) const {
+    return FindTopDocumentsForQuery<Scorer>(executionPolicy, ParseQuery(raw_query),
+                                            MakePredicateFilter(document_predicate), result_limit);
 }
 
-template<typename DocumentPredicate, typename ExecutionPolicy>
+template<typename Scorer, typename ExecutionPolicy>
 [[nodiscard]] std::vector<Document>
 SearchServer::FindTopDocuments(ExecutionPolicy &executionPolicy, std::string_view raw_query,
-                               DocumentPredicate document_predicate) const {
+                               DocumentStatus status, size_t result_limit) const {
     const auto query = ParseQuery(raw_query);
+    const auto document_filter = MakeStatusFilter(status);
+    if (!query_cache_) {
+        return FindTopDocumentsForQuery<Scorer>(executionPolicy, query, document_filter, result_limit);
+    }
 
-    auto matched_documents = FindAllDocuments(executionPolicy, query, document_predicate);
-
-    sort(executionPolicy, matched_documents.begin(), matched_documents.end(),
-         [](const Document &lhs, const Document &rhs) {
-             if (std::abs(lhs.relevance - rhs.relevance) < EPSILON) {
-                 return lhs.rating > rhs.rating;
-             } else {
-                 return lhs.relevance > rhs.relevance;
-             }
-         });
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+    std::string key = MakeQueryCacheKey(query, Scorer::NAME, status, result_limit);
+    if (auto documents = query_cache_->Find(key, generation_)) {
+        return std::move(*documents);
     }
+    auto documents = FindTopDocumentsForQuery<Scorer>(executionPolicy, query, document_filter, result_limit);
+    query_cache_->Insert(std::move(key), generation_, documents);
+    return documents;
+}
 
-    return matched_documents;
+template<typename Scorer>
+[[nodiscard]] std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status,
+                                                                   size_t result_limit) const {
+    return FindTopDocuments<Scorer>(std::execution::seq, raw_query, status, result_limit);
 }
 
-template<typename ExecutionPolicy>
+template<typename Scorer, typename ExecutionPolicy>
 [[nodiscard]] std::vector<Document>
 SearchServer::FindTopDocuments(ExecutionPolicy &executionPolicy, std::string_view raw_query,
-                               DocumentStatus status) const {
-    return FindTopDocuments(executionPolicy,
-            raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
-                return document_status == status;
-            });
+                               size_t result_limit) const {
+    return FindTopDocuments<Scorer>(executionPolicy, raw_query, DocumentStatus::ACTUAL, result_limit);
+
 }
 
-template<typename ExecutionPolicy>
-[[nodiscard]] std::vector<Document>
-SearchServer::FindTopDocuments(ExecutionPolicy &executionPolicy, std::string_view raw_query) const {
-    return FindTopDocuments(executionPolicy, raw_query, DocumentStatus::ACTUAL);
+template<typename Scorer>
+[[nodiscard]] std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query,
+                                                                   size_t result_limit) const {
+    return FindTopDocuments<Scorer>(raw_query, DocumentStatus::ACTUAL, result_limit);
+}
 
+template<typename Scorer, typename DocumentFilter, typename ExecutionPolicy>
+std::vector<Document>
+SearchServer::FindTopDocumentsForQuery(ExecutionPolicy &executionPolicy, const Query &query,
+                                       DocumentFilter document_filter, size_t result_limit) const {
+    TopDocumentsCollector collector(result_limit);
+    const Scorer scorer(GetAverageWordCount());
+    if (query.phrases.empty()) {
+        FindAllDocuments(executionPolicy, query, scorer, document_filter, collector);
+    } else {
+        FindPhraseDocuments(query, scorer, document_filter, collector);
+    }
+
+    return collector.Extract();
 }
 
-template<typename DocumentPredicate>
-[[nodiscard]] std::vector<Document> SearchServer::FindAllDocuments(const Query &query,
-                                                                   DocumentPredicate document_predicate) const {
-    std::map<int, double> document_to_relevance;
+template<typename Scorer, typename DocumentFilter>
+void SearchServer::FindAllDocuments(const Query &query, const Scorer &scorer, DocumentFilter document_filter,
+                                    TopDocumentsCollector &collector) const {
+    const DocumentBitmap excluded = FindExcludedDocuments(query);
+    ScoreAccumulator &document_to_relevance = GetThreadScoreAccumulator();
+    document_to_relevance.Reset(ordinal_to_document_id_.size());
     for (const auto &word: query.plus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
+        const PostingList *postings = FindPostings(word);
+        if (postings == nullptr) {
             continue;
         }
-        const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-        for (const auto [document_id, term_freq]: word_to_document_freqs_.at(word)) {
-            const auto &document_data = documents_.at(document_id);
-            if (document_predicate(document_id, document_data.status, document_data.rating)) {
-                document_to_relevance[document_id] += term_freq * inverse_document_freq;
+        const double inverse_document_freq = ComputeWordInverseDocumentFreq<Scorer>(word, *postings);
+        DocumentBitmap::Cursor excluded_cursor(excluded);
+        for (PostingCursor cursor(*postings); !cursor.IsEnd(); cursor.Next()) {
+            const uint32_t document_ordinal = cursor.GetOrdinal();
+            if (!excluded_cursor.Contains(document_ordinal) && document_filter(document_ordinal)) {
+                document_to_relevance.Add(document_ordinal, ScoreTermFreq(scorer, cursor) * inverse_document_freq);
             }
         }
     }
 
-    for (const auto &word: query.minus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
+    document_to_relevance.ForEach([this, &collector](uint32_t document_ordinal, double relevance) {
+        collector.Add({ordinal_to_document_id_[document_ordinal], relevance, ordinal_to_rating_[document_ordinal]});
+    });
+}
+
+template<typename Scorer, typename DocumentFilter>
+void SearchServer::FindPhraseDocuments(const Query &query, const Scorer &scorer, DocumentFilter document_filter,
+                                       TopDocumentsCollector &collector) const {
+    struct TermCursor {
+        PostingCursor cursor;
+        double inverse_document_freq;
+    };
+    // Kept in plus-word order, so relevance is summed exactly as in exhaustive evaluation
+    std::vector<TermCursor> plus_terms;
+    for (const auto &word: query.plus_words) {
+        if (const PostingList *postings = FindPostings(word)) {
+            plus_terms.push_back({PostingCursor(*postings), ComputeWordInverseDocumentFreq<Scorer>(word, *postings)});
+        }
+    }
+    const DocumentBitmap excluded = FindExcludedDocuments(query);
+    DocumentBitmap::Cursor excluded_cursor(excluded);
+
+    PhraseMatcher matcher(*this, query.phrases);
+    for (uint32_t ordinal = matcher.FindNext(0); ordinal != PostingCursor::END_ORDINAL;
+         ordinal = matcher.FindNext(ordinal + 1)) {
+        if (excluded_cursor.Contains(ordinal) || !document_filter(ordinal)) {
             continue;
         }
-        for (const auto [document_id, _]: word_to_document_freqs_.at(word)) {
-            document_to_relevance.erase(document_id);
+        double relevance = 0.0;
+        for (auto &term: plus_terms) {
+            term.cursor.AdvanceTo(ordinal);
+            if (term.cursor.GetOrdinal() == ordinal) {
+                relevance += ScoreTermFreq(scorer, term.cursor) * term.inverse_document_freq;
+            }
         }
+        collector.Add({ordinal_to_document_id_[ordinal], relevance, ordinal_to_rating_[ordinal]});
     }
+}
 
-    std::vector<Document> matched_documents;
-    matched_documents.reserve(document_to_relevance.size());
+template<typename Scorer, typename DocumentFilter>
+void SearchServer::FindAllDocuments(const std::execution::sequenced_policy &executionPolicy, const Query &query,
+                                    const Scorer &scorer, DocumentFilter document_filter,
+                                    TopDocumentsCollector &collector) const {
+    FindAllDocuments(query, scorer, document_filter, collector);
+}
 
-    for (const auto [document_id, relevance]: document_to_relevance) {
-        matched_documents.emplace_back(document_id, relevance, documents_.at(document_id).rating);
-    }
-    return matched_documents;
+template<typename Scorer, typename DocumentFilter>
+void SearchServer::FindAllDocuments(const std::execution::parallel_policy &executionPolicy, const Query &query,
+                                    const Scorer &scorer, DocumentFilter document_filter,
+                                    TopDocumentsCollector &collector) const {
+    const size_t max_range_count = std::max(1u, std::thread::hardware_concurrency()) * 4;
+    FindAllDocumentsInRanges(query, scorer, document_filter, collector, max_range_count,
+                             [&executionPolicy](size_t range_count, const auto &function) {
+                                 std::vector<size_t> ranges(range_count);
+                                 std::iota(ranges.begin(), ranges.end(), 0);
+                                 std::for_each(executionPolicy, ranges.begin(), ranges.end(), function);
+                             });
 }
 
-template<typename DocumentPredicate>
-std::vector<Document>
-SearchServer::FindAllDocuments(const std::execution::sequenced_policy &executionPolicy, const Query &query,
-                               DocumentPredicate document_predicate) const {
-    return FindAllDocuments(query, document_predicate);
+template<typename Scorer, typename DocumentFilter>
+void SearchServer::FindAllDocuments(QueryExecutor &executor, const Query &query, const Scorer &scorer,
+                                    DocumentFilter document_filter, TopDocumentsCollector &collector) const {
+    FindAllDocumentsInRanges(query, scorer, document_filter, collector, executor.GetWorkerCount() * 4,
+                             [&executor](size_t range_count, const auto &function) {
+                                 executor.ParallelFor(range_count, function);
+                             });
 }
 
-template<typename DocumentPredicate>
-std::vector<Document>
-SearchServer::FindAllDocuments(const std::execution::parallel_policy &executionPolicy, const Query &query,
-                               DocumentPredicate document_predicate) const {
-    ConcurrentMap<int, double> document_to_relevance(documents_.size() / 4);
-
-    std::for_each(executionPolicy, query.plus_words.begin(), query.plus_words.end(),
-                  [this, &document_to_relevance, &document_predicate](std::string_view word) {
-                      if (word_to_document_freqs_.count(word)) {
-                          const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-                          for (const auto [document_id, term_freq]: word_to_document_freqs_.at(word)) {
-                              const auto &document_data = documents_.at(document_id);
-                              if (document_predicate(document_id, document_data.status, document_data.rating)) {
-                                  document_to_relevance[document_id].ref_to_value += term_freq * inverse_document_freq;
-                              }
-                          }
-                      }
-                  });
-
-    std::for_each(executionPolicy, query.minus_words.begin(), query.minus_words.end(),
-                  [this, &document_to_relevance](std::string_view word) {
-                      if (word_to_document_freqs_.count(word)) {
-                          for (const auto [document_id, _]: word_to_document_freqs_.at(word)) {
-                              document_to_relevance.Erase(document_id);
-                          }
-                      }
-                  });
-
-    auto document_to_relevance_temp = std::move(document_to_relevance.BuildOrdinaryMap());
-    std::vector<Document> to_return;
-
-    for (const auto [document_id, relevance]: document_to_relevance_temp) {
-        to_return.emplace_back(document_id, relevance, documents_.at(document_id).rating);
+template<typename Scorer, typename DocumentFilter, typename ForEachRange>
+void SearchServer::FindAllDocumentsInRanges(const Query &query, const Scorer &scorer,
+                                            DocumentFilter document_filter, TopDocumentsCollector &collector,
+                                            size_t max_range_count, ForEachRange for_each_range) const {
+    struct Term {
+        const PostingList *postings;
+        double inverse_document_freq;
+    };
+    std::vector<Term> plus_terms;
+    for (const auto &word: query.plus_words) {
+        if (const PostingList *postings = FindPostings(word)) {
+            plus_terms.push_back({postings, ComputeWordInverseDocumentFreq<Scorer>(word, *postings)});
+        }
+    }
+    const DocumentBitmap excluded = FindExcludedDocuments(query);
+
+    // Every task scores its own range of ordinals in the accumulator of its thread and keeps its own top
+    // documents, so tasks share nothing until the results are merged
+    const auto ordinal_count = static_cast<uint32_t>(ordinal_to_document_id_.size());
+    const size_t range_count = std::clamp<size_t>(ordinal_count / MIN_PARALLEL_RANGE_SIZE, 1, max_range_count);
+    std::vector<TopDocumentsCollector> range_collectors(range_count, TopDocumentsCollector(collector.GetLimit()));
+    for_each_range(range_count, [&](size_t range) {
+        const auto begin = static_cast<uint32_t>(uint64_t{ordinal_count} * range / range_count);
+        const auto end = static_cast<uint32_t>(uint64_t{ordinal_count} * (range + 1) / range_count);
+        ScoreAccumulator &document_to_relevance = GetThreadScoreAccumulator();
+        document_to_relevance.Reset(ordinal_count);
+        for (const auto &term: plus_terms) {
+            PostingCursor cursor(*term.postings);
+            DocumentBitmap::Cursor excluded_cursor(excluded);
+            for (cursor.AdvanceTo(begin); cursor.GetOrdinal() < end; cursor.Next()) {
+                if (!excluded_cursor.Contains(cursor.GetOrdinal()) && document_filter(cursor.GetOrdinal())) {
+                    document_to_relevance.Add(cursor.GetOrdinal(),
+                                              ScoreTermFreq(scorer, cursor) * term.inverse_document_freq);
+                }
+            }
+        }
+
+        auto &range_collector = range_collectors[range];
+        document_to_relevance.ForEach([this, &range_collector](uint32_t document_ordinal, double relevance) {
+            range_collector.Add({ordinal_to_document_id_[document_ordinal], relevance,
+                                 ordinal_to_rating_[document_ordinal]});
+        });
+    });
+
+    for (auto &range_collector: range_collectors) {
+        for (const auto &document: range_collector.Extract()) {
+            collector.Add(document);
+        }
     }
-    return to_return;
+}
+
+template<typename Scorer, typename DocumentFilter>
+void SearchServer::FindAllDocuments(const search_policy::block_max_wand_policy &, const Query &query,
+                                    const Scorer &scorer, DocumentFilter document_filter,
+                                    TopDocumentsCollector &collector) const {
+    struct TermCursor {
+        PostingCursor cursor;
+        double inverse_document_freq;
+        double max_score;
+    };
 
+    // Kept in plus-word order, so relevance is summed exactly as in exhaustive evaluation
+    std::vector<TermCursor> terms;
+    for (const auto &word: query.plus_words) {
+        const PostingList *postings = FindPostings(word);
+        if (postings == nullptr || postings->empty()) {
+            continue;
+        }
+        const double inverse_document_freq = ComputeWordInverseDocumentFreq<Scorer>(word, *postings);
+        terms.push_back({PostingCursor(*postings), inverse_document_freq,
+                         scorer.GetMaxTermScore(postings->GetMaxTermFreq()) * inverse_document_freq});
+    }
+
+    const DocumentBitmap excluded = FindExcludedDocuments(query);
+    DocumentBitmap::Cursor excluded_cursor(excluded);
+
+    std::vector<TermCursor *> ordered;
+    for (auto &term: terms) {
+        ordered.push_back(&term);
+    }
+
+    while (true) {
+        // Only the cursors at the front move between iterations, so insertion sort is close to linear here
+        for (size_t i = 1; i < ordered.size(); ++i) {
+            TermCursor *term = ordered[i];
+            size_t j = i;
+            for (; j > 0 && ordered[j - 1]->cursor.GetOrdinal() > term->cursor.GetOrdinal(); --j) {
+                ordered[j] = ordered[j - 1];
+            }
+            ordered[j] = term;
+        }
+        const double threshold = collector.GetAdmissionThreshold();
+
+        // The pivot is the first document whose score bound, summed over all terms up to it, can pass the threshold
+        size_t pivot = 0;
+        double upper_bound = 0.0;
+        while (pivot < ordered.size() && !ordered[pivot]->cursor.IsEnd()) {
+            upper_bound += ordered[pivot]->max_score;
+            if (upper_bound > threshold) {
+                break;
+            }
+            ++pivot;
+        }
+        if (pivot == ordered.size() || ordered[pivot]->cursor.IsEnd()) {
+            break;
+        }
+        const uint32_t pivot_ordinal = ordered[pivot]->cursor.GetOrdinal();
+        while (pivot + 1 < ordered.size() && ordered[pivot + 1]->cursor.GetOrdinal() == pivot_ordinal) {
+            ++pivot;
+        }
+
+        // Tighter bound from the maxima of the blocks that may hold the pivot
+        uint32_t next_ordinal = pivot + 1 < ordered.size() ? ordered[pivot + 1]->cursor.GetOrdinal()
+                                                           : PostingCursor::END_ORDINAL;
+        double block_upper_bound = 0.0;
+        for (size_t i = 0; i <= pivot; ++i) {
+            const PostingBlock *block = ordered[i]->cursor.FindBlock(pivot_ordinal);
+            if (block != nullptr) {
+                block_upper_bound += scorer.GetMaxTermScore(block->max_term_freq) * ordered[i]->inverse_document_freq;
+                next_ordinal = std::min(next_ordinal, block->last_ordinal + 1);
+            }
+        }
+        if (block_upper_bound <= threshold) {
+            // No document before next_ordinal can pass the threshold
+            for (size_t i = 0; i <= pivot; ++i) {
+                ordered[i]->cursor.AdvanceTo(next_ordinal);
+            }
+            continue;
+        }
+
+        if (ordered[0]->cursor.GetOrdinal() != pivot_ordinal) {
+            for (size_t i = 0; ordered[i]->cursor.GetOrdinal() < pivot_ordinal; ++i) {
+                ordered[i]->cursor.AdvanceTo(pivot_ordinal);
+            }
+            continue;
+        }
+
+        if (!excluded_cursor.Contains(pivot_ordinal) && document_filter(pivot_ordinal)) {
+            double relevance = 0.0;
+            for (const auto &term: terms) {
+                if (term.cursor.GetOrdinal() == pivot_ordinal) {
+                    relevance += ScoreTermFreq(scorer, term.cursor) * term.inverse_document_freq;
+                }
+            }
+            collector.Add({ordinal_to_document_id_[pivot_ordinal], relevance, ordinal_to_rating_[pivot_ordinal]});
+        }
+        for (size_t i = 0; i <= pivot; ++i) {
+            ordered[i]->cursor.Next();
+        }
+    }
+}
+
+template<typename Scorer>
+double SearchServer::ComputeWordInverseDocumentFreq(std::string_view word, const PostingList &postings) const {
+    if (collection_statistics_ != nullptr) {
+        const auto document_freq = static_cast<double>(collection_statistics_->GetDocumentFrequency(word));
+        return Scorer::ComputeInverseDocumentFreq(static_cast<double>(collection_statistics_->GetDocumentCount()),
+                                                  document_freq);
+    }
+    return Scorer::ComputeInverseDocumentFreq(GetDocumentCount(), static_cast<double>(postings.size()));
 }
 
 template<typename StringContainer>
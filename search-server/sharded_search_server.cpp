@@ -0,0 +1,91 @@
+#include "sharded_search_server.h"
+
+ShardedSearchServer::ShardedSearchServer(const std::string &stop_words_text, size_t shard_count)
+        : ShardedSearchServer(SplitIntoWords(stop_words_text), shard_count) {
+}
+
+void ShardedSearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status,
+                                      const std::vector<int> &ratings) {
+    if (document_id < 0) {
+        throw std::invalid_argument("Invalid document_id"s);
+    }
+    auto &shard = shards_[GetShardIndex(document_id)];
+    shard.AddDocument(document_id, document, status, ratings);
+    statistics_.AddDocument(shard.GetWordFrequencies(document_id));
+}
+
+void ShardedSearchServer::AddDocuments(const std::vector<DocumentInput> &documents) {
+    std::vector<std::vector<DocumentInput>> shard_documents(shards_.size());
+    for (const auto &document: documents) {
+        if (document.id < 0) {
+            throw std::invalid_argument("Invalid document_id"s);
+        }
+        shard_documents[GetShardIndex(document.id)].push_back(document);
+    }
+
+    std::vector<char> is_added(shards_.size(), false);
+    try {
+        ForEachShard([&](size_t i) {
+            shards_[i].AddDocuments(std::execution::seq, shard_documents[i]);
+            is_added[i] = true;
+        });
+    } catch (...) {
+        // A shard that failed added nothing, the others are rolled back
+        for (size_t i = 0; i < shards_.size(); ++i) {
+            if (is_added[i]) {
+                for (const auto &document: shard_documents[i]) {
+                    shards_[i].RemoveDocument(document.id);
+                }
+            }
+        }
+        throw;
+    }
+
+    for (const auto &document: documents) {
+        statistics_.AddDocument(shards_[GetShardIndex(document.id)].GetWordFrequencies(document.id));
+    }
+}
+
+void ShardedSearchServer::RemoveDocument(int document_id) {
+    if (document_id < 0) {
+        return;
+    }
+    auto &shard = shards_[GetShardIndex(document_id)];
+    const WordFrequencies word_freqs = shard.GetWordFrequencies(document_id);
+    if (!word_freqs.empty()) {
+        // The view refers to the index of the shard, so the words are counted out before the document is removed
+        statistics_.RemoveDocument(word_freqs);
+        shard.RemoveDocument(document_id);
+        return;
+    }
+
+    // The document either does not exist or has no words
+    const int document_count = shard.GetDocumentCount();
+    shard.RemoveDocument(document_id);
+    if (shard.GetDocumentCount() != document_count) {
+        statistics_.RemoveDocument({});
+    }
+}
+
+void ShardedSearchServer::EnablePositionalIndex() {
+    ForEachShard([this](size_t i) {
+        shards_[i].EnablePositionalIndex();
+    });
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus>
+ShardedSearchServer::MatchDocument(std::string_view raw_query, int document_id) const {
+    if (document_id < 0) {
+        throw std::out_of_range("Invalid document_id"s);
+    }
+    return shards_[GetShardIndex(document_id)].MatchDocument(raw_query, document_id);
+}
+
+int ShardedSearchServer::GetDocumentCount() const {
+    return static_cast<int>(statistics_.GetDocumentCount());
+}
+
+size_t ShardedSearchServer::GetShardIndex(int document_id) const {
+    // Ids are usually dense, so taking the remainder spreads them evenly
+    return static_cast<size_t>(document_id) % shards_.size();
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <exception>
+#include <numeric>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+#include "collection_statistics.h"
+#include "search_server.h"
+
+// Splits documents between independent SearchServer shards by id. A query is evaluated on all shards in
+// parallel and their top documents are merged; relevance uses the statistics of the whole collection,
+// so the result is the same as of a single server holding every document.
+class ShardedSearchServer {
+public:
+    template<typename StringContainer>
+    ShardedSearchServer(const StringContainer &stop_words, size_t shard_count);
+
+    ShardedSearchServer(const std::string &stop_words_text, size_t shard_count);
+
+    // Shards refer to the statistics of this object
+    ShardedSearchServer(const ShardedSearchServer &) = delete;
+
+    ShardedSearchServer &operator=(const ShardedSearchServer &) = delete;
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status,
+                     const std::vector<int> &ratings);
+
+    // Adds nothing if any record is invalid
+    void AddDocuments(const std::vector<DocumentInput> &documents);
+
+    void RemoveDocument(int document_id);
+
+    // Enables phrase queries on every shard
+    void EnablePositionalIndex();
+
+    // Scorer is the relevance model from scoring.h, as in SearchServer
+    template<typename Scorer = scoring::TfIdf, typename DocumentPredicate,
+            typename = SearchServer::EnableIfPredicate<DocumentPredicate>>
+    [[nodiscard]] std::vector<Document> FindTopDocuments(std::string_view raw_query,
+                                                         DocumentPredicate document_predicate,
+                                                         size_t result_limit = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    template<typename Scorer = scoring::TfIdf>
+    [[nodiscard]] std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status,
+                                                         size_t result_limit = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    template<typename Scorer = scoring::TfIdf>
+    [[nodiscard]] std::vector<Document> FindTopDocuments(std::string_view raw_query,
+                                                         size_t result_limit = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    [[nodiscard]] std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(std::string_view raw_query,
+                                                                                          int document_id) const;
+
+    [[nodiscard]] int GetDocumentCount() const;
+
+private:
+    CollectionStatistics statistics_;
+    std::vector<SearchServer> shards_;
+
+    [[nodiscard]] size_t GetShardIndex(int document_id) const;
+
+    // Merges the top documents find_in_shard(shard) returns for every shard
+    template<typename FindInShard>
+    [[nodiscard]] std::vector<Document> MergeShardResults(size_t result_limit, FindInShard find_in_shard) const;
+
+    // Calls function(shard_index) for all shards in parallel and rethrows the first exception, if any
+    template<typename Function>
+    void ForEachShard(Function function) const;
+};
+
+template<typename StringContainer>
+ShardedSearchServer::ShardedSearchServer(const StringContainer &stop_words, size_t shard_count) {
+    if (shard_count == 0) {
+        throw std::invalid_argument("Shard count must be positive"s);
+    }
+    shards_.reserve(shard_count);
+    for (size_t i = 0; i < shard_count; ++i) {
+        shards_.emplace_back(stop_words).SetCollectionStatistics(&statistics_);
+    }
+}
+
+template<typename Scorer, typename DocumentPredicate, typename>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(std::string_view raw_query,
+                                                            DocumentPredicate document_predicate,
+                                                            size_t result_limit) const {
+    return MergeShardResults(result_limit, [&](const SearchServer &shard) {
+        return shard.FindTopDocuments<Scorer>(search_policy::block_max_wand, raw_query, document_predicate,
+                                              result_limit);
+    });
+}
+
+template<typename Scorer>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status,
+                                                            size_t result_limit) const {
+    return MergeShardResults(result_limit, [&](const SearchServer &shard) {
+        return shard.FindTopDocuments<Scorer>(search_policy::block_max_wand, raw_query, status, result_limit);
+    });
+}
+
+template<typename Scorer>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(std::string_view raw_query, size_t result_limit) const {
+    return FindTopDocuments<Scorer>(raw_query, DocumentStatus::ACTUAL, result_limit);
+}
+
+template<typename FindInShard>
+std::vector<Document> ShardedSearchServer::MergeShardResults(size_t result_limit, FindInShard find_in_shard) const {
+    std::vector<std::vector<Document>> shard_documents(shards_.size());
+    ForEachShard([&](size_t i) {
+        shard_documents[i] = find_in_shard(shards_[i]);
+    });
+
+    TopDocumentsCollector collector(result_limit);
+    for (const auto &documents: shard_documents) {
+        for (const auto &document: documents) {
+            collector.Add(document);
+        }
+    }
+    return collector.Extract();
+}
+
+template<typename Function>
+void ShardedSearchServer::ForEachShard(Function function) const {
+    std::vector<size_t> indexes(shards_.size());
+    std::iota(indexes.begin(), indexes.end(), 0);
+    // An exception escaping a parallel algorithm would terminate the program
+    std::vector<std::exception_ptr> errors(shards_.size());
+    std::for_each(std::execution::par, indexes.begin(), indexes.end(), [&](size_t i) {
+        try {
+            function(i);
+        } catch (...) {
+            errors[i] = std::current_exception();
+        }
+    });
+    for (const auto &error: errors) {
+        if (error != nullptr) {
+            std::rethrow_exception(error);
+        }
+    }
+}
@@ -0,0 +1,174 @@
+#include "snapshot.h"
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define SNAPSHOT_USE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std::string_literals;
+
+namespace {
+    const char SNAPSHOT_MAGIC[8] = {'S', 'R', 'C', 'H', 'S', 'N', 'A', 'P'};
+    const uint32_t SNAPSHOT_VERSION = 8;
+    const size_t ALIGNMENT = 8;
+
+    struct SnapshotHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t reserved;
+        uint64_t payload_size;
+        uint64_t checksum;
+    };
+
+    const uint64_t CHECKSUM_SEED = 0x736e617073686f74ULL;
+
+    // Hashes 8-byte words; a trailing partial word is padded with zeros like in the file
+    uint64_t UpdateChecksum(uint64_t checksum, const char *data, size_t size) {
+        for (size_t i = 0; i < size; i += ALIGNMENT) {
+            uint64_t word = 0;
+            std::memcpy(&word, data + i, std::min(ALIGNMENT, size - i));
+            checksum = (checksum ^ word) * 0x9e3779b97f4a7c15ULL;
+            checksum ^= checksum >> 29;
+        }
+        return checksum;
+    }
+}
+
+MappedFile::MappedFile(const std::string &path) {
+#ifdef SNAPSHOT_USE_MMAP
+    const int descriptor = open(path.c_str(), O_RDONLY);
+    if (descriptor < 0) {
+        throw std::runtime_error("Cannot open file "s + path);
+    }
+    struct stat file_stat{};
+    if (fstat(descriptor, &file_stat) != 0) {
+        close(descriptor);
+        throw std::runtime_error("Cannot read file "s + path);
+    }
+    size_ = static_cast<size_t>(file_stat.st_size);
+    if (size_ > 0) {
+        void *mapping = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        if (mapping == MAP_FAILED) {
+            close(descriptor);
+            throw std::runtime_error("Cannot map file "s + path);
+        }
+        data_ = static_cast<const char *>(mapping);
+    }
+    close(descriptor);
+#else
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) {
+        throw std::runtime_error("Cannot open file "s + path);
+    }
+    size_ = static_cast<size_t>(in.tellg());
+    buffer_.resize((size_ + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+    in.seekg(0);
+    in.read(reinterpret_cast<char *>(buffer_.data()), static_cast<std::streamsize>(size_));
+    data_ = reinterpret_cast<const char *>(buffer_.data());
+#endif
+}
+
+MappedFile::~MappedFile() {
+#ifdef SNAPSHOT_USE_MMAP
+    if (data_ != nullptr) {
+        munmap(const_cast<char *>(data_), size_);
+    }
+#endif
+}
+
+SnapshotWriter::SnapshotWriter(const std::string &path)
+        : path_(path), temporary_path_(path + ".tmp"s), out_(temporary_path_, std::ios::binary | std::ios::trunc),
+          checksum_(CHECKSUM_SEED) {
+    if (!out_) {
+        throw std::runtime_error("Cannot create file "s + temporary_path_);
+    }
+    const SnapshotHeader header{};
+    out_.write(reinterpret_cast<const char *>(&header), sizeof(header));
+}
+
+void SnapshotWriter::Finish() {
+    SnapshotHeader header{};
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header.version = SNAPSHOT_VERSION;
+    header.payload_size = payload_size_;
+    header.checksum = checksum_;
+    out_.seekp(0);
+    out_.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out_.close();
+    if (!out_) {
+        throw std::runtime_error("Cannot write snapshot"s);
+    }
+#ifdef SNAPSHOT_USE_MMAP
+    // The data has to reach the disk before the rename does, or a crash may leave a renamed empty file
+    const int descriptor = open(temporary_path_.c_str(), O_RDONLY);
+    const bool is_synced = descriptor >= 0 && fsync(descriptor) == 0;
+    if (descriptor >= 0) {
+        close(descriptor);
+    }
+    if (!is_synced) {
+        throw std::runtime_error("Cannot write snapshot"s);
+    }
+#endif
+    if (std::rename(temporary_path_.c_str(), path_.c_str()) != 0) {
+        throw std::runtime_error("Cannot replace file "s + path_);
+    }
+    is_finished_ = true;
+}
+
+SnapshotWriter::~SnapshotWriter() {
+    if (!is_finished_) {
+        out_.close();
+        std::remove(temporary_path_.c_str());
+    }
+}
+
+void SnapshotWriter::WriteBytes(const void *data, size_t size) {
+    const char zeros[ALIGNMENT] = {};
+    const size_t padding = (ALIGNMENT - size % ALIGNMENT) % ALIGNMENT;
+    out_.write(static_cast<const char *>(data), static_cast<std::streamsize>(size));
+    out_.write(zeros, static_cast<std::streamsize>(padding));
+    checksum_ = UpdateChecksum(checksum_, static_cast<const char *>(data), size);
+    payload_size_ += size + padding;
+}
+
+SnapshotReader::SnapshotReader(const MappedFile &file, bool verify_checksum) {
+    SnapshotHeader header{};
+    if (file.size() < sizeof(header)) {
+        ThrowCorrupted();
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0) {
+        throw std::runtime_error("Not a search server snapshot"s);
+    }
+    if (header.version != SNAPSHOT_VERSION) {
+        throw std::runtime_error("Unsupported snapshot version "s + std::to_string(header.version));
+    }
+    if (header.payload_size != file.size() - sizeof(header)) {
+        ThrowCorrupted();
+    }
+    position_ = file.data() + sizeof(header);
+    end_ = position_ + header.payload_size;
+    if (verify_checksum && UpdateChecksum(CHECKSUM_SEED, position_, header.payload_size) != header.checksum) {
+        ThrowCorrupted();
+    }
+}
+
+const char *SnapshotReader::ReadBytes(size_t size) {
+    const size_t padded_size = (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    if (padded_size > static_cast<size_t>(end_ - position_)) {
+        ThrowCorrupted();
+    }
+    const char *data = position_;
+    position_ += padded_size;
+    return data;
+}
+
+void SnapshotReader::ThrowCorrupted() {
+    throw std::runtime_error("Snapshot is damaged"s);
+}
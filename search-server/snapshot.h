@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include "mapped_array.h"
+
+// Read-only mapping of a whole file into memory
+class MappedFile {
+public:
+    explicit MappedFile(const std::string &path);
+
+    MappedFile(const MappedFile &) = delete;
+
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    ~MappedFile();
+
+    [[nodiscard]] const char *data() const {
+        return data_;
+    }
+
+    [[nodiscard]] size_t size() const {
+        return size_;
+    }
+
+private:
+    const char *data_ = nullptr;
+    size_t size_ = 0;
+    // Used instead of a mapping where mmap is not available
+    std::vector<uint64_t> buffer_;
+};
+
+// Writes a snapshot image: a header with magic, format version and checksum, followed by a payload of
+// values and arrays. Every item is padded to 8 bytes, so arrays can be used in place once the file is mapped.
+// The image uses the byte order and struct layout of the machine that wrote it. It is written to a temporary
+// file next to the destination and renamed over it, so a failed save keeps the previous snapshot and servers
+// still mapping it keep reading the old file.
+class SnapshotWriter {
+public:
+    explicit SnapshotWriter(const std::string &path);
+
+    SnapshotWriter(const SnapshotWriter &) = delete;
+
+    SnapshotWriter &operator=(const SnapshotWriter &) = delete;
+
+    // Removes the temporary file unless the image was finished
+    ~SnapshotWriter();
+
+    template<typename T>
+    void WriteValue(const T &value) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        WriteBytes(&value, sizeof(T));
+    }
+
+    template<typename T>
+    void WriteArray(const T *data, size_t size) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        WriteValue<uint64_t>(size);
+        WriteBytes(data, size * sizeof(T));
+    }
+
+    void WriteString(std::string_view text) {
+        WriteArray(text.data(), text.size());
+    }
+
+    // Completes the header, syncs the image to disk and replaces the destination with it
+    void Finish();
+
+private:
+    std::string path_;
+    std::string temporary_path_;
+    std::ofstream out_;
+    bool is_finished_ = false;
+    uint64_t payload_size_ = 0;
+    uint64_t checksum_;
+
+    void WriteBytes(const void *data, size_t size);
+};
+
+// Reads a snapshot image written by SnapshotWriter. Arrays are returned as views into the mapping.
+// Throws runtime_error if the file is not a snapshot of the current version or is damaged.
+class SnapshotReader {
+public:
+    // Checking the checksum reads the whole file, skipping it lets the pages be loaded on demand
+    SnapshotReader(const MappedFile &file, bool verify_checksum);
+
+    template<typename T>
+    T ReadValue() {
+        static_assert(std::is_trivially_copyable_v<T>);
+        T value;
+        std::memcpy(&value, ReadBytes(sizeof(T)), sizeof(T));
+        return value;
+    }
+
+    template<typename T>
+    MappedArray<T> ReadArray() {
+        static_assert(std::is_trivially_copyable_v<T>);
+        const auto size = ReadValue<uint64_t>();
+        if (size > (end_ - position_) / sizeof(T)) {
+            ThrowCorrupted();
+        }
+        return MappedArray<T>(reinterpret_cast<const T *>(ReadBytes(size * sizeof(T))), size);
+    }
+
+    std::string_view ReadString() {
+        const auto characters = ReadArray<char>();
+        return {characters.data(), characters.size()};
+    }
+
+    [[noreturn]] static void ThrowCorrupted();
+
+private:
+    const char *position_;
+    const char *end_;
+
+    const char *ReadBytes(size_t size);
+};
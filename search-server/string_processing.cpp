@@ -1,7 +1,116 @@
+#include "string_processing.h"
+#include <algorithm>
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <iostream>
 
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace {
+    const size_t CHUNK_SIZE = 32;
+
+    unsigned CountTrailingZeros(uint32_t mask) {
+#if defined(__GNUC__)
+        return __builtin_ctz(mask);
+#else
+        unsigned count = 0;
+        while ((mask & 1) == 0) {
+            mask >>= 1;
+            ++count;
+        }
+        return count;
+#endif
+    }
+
+    // Appends the words that end inside a chunk of text, given the bitmask of space bytes in the chunk.
+    // word_begin is the offset of the word being read or npos between words, and is carried to the next chunk.
+    void CollectWords(std::string_view text, size_t chunk_begin, size_t chunk_size, uint32_t space_mask,
+                      size_t &word_begin, std::vector<std::string_view> &words) {
+        const uint32_t chunk_mask = chunk_size == CHUNK_SIZE ? UINT32_MAX : (1u << chunk_size) - 1;
+        size_t position = 0;
+        while (position < chunk_size) {
+            if (word_begin == std::string_view::npos) {
+                const uint32_t word_bytes = ~space_mask & chunk_mask & (UINT32_MAX << position);
+                if (word_bytes == 0) {
+                    return;
+                }
+                position = CountTrailingZeros(word_bytes);
+                word_begin = chunk_begin + position;
+            } else {
+                const uint32_t spaces = space_mask & (UINT32_MAX << position);
+                if (spaces == 0) {
+                    return;
+                }
+                position = CountTrailingZeros(spaces);
+                words.push_back(text.substr(word_begin, chunk_begin + position - word_begin));
+                word_begin = std::string_view::npos;
+            }
+        }
+    }
+
+    bool IsControlCharacter(char c) {
+        return c >= '\0' && c < ' ';
+    }
+
+    template<bool Validate>
+    bool SplitIntoWordsImpl(std::string_view text, std::vector<std::string_view> &words) {
+        words.clear();
+        size_t word_begin = std::string_view::npos;
+        size_t i = 0;
+
+#if defined(__AVX2__)
+        const __m256i spaces = _mm256_set1_epi8(' ');
+        const __m256i minus_one = _mm256_set1_epi8(-1);
+        for (; i + 32 <= text.size(); i += 32) {
+            const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(text.data() + i));
+            if (Validate) {
+                const __m256i controls = _mm256_and_si256(_mm256_cmpgt_epi8(spaces, bytes),
+                                                          _mm256_cmpgt_epi8(bytes, minus_one));
+                if (_mm256_movemask_epi8(controls) != 0) {
+                    return false;
+                }
+            }
+            const auto space_mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, spaces)));
+            CollectWords(text, i, 32, space_mask, word_begin, words);
+        }
+#elif defined(__SSE2__)
+        const __m128i spaces = _mm_set1_epi8(' ');
+        const __m128i minus_one = _mm_set1_epi8(-1);
+        for (; i + 16 <= text.size(); i += 16) {
+            const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(text.data() + i));
+            if (Validate) {
+                const __m128i controls = _mm_and_si128(_mm_cmplt_epi8(bytes, spaces), _mm_cmpgt_epi8(bytes, minus_one));
+                if (_mm_movemask_epi8(controls) != 0) {
+                    return false;
+                }
+            }
+            const auto space_mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, spaces)));
+            CollectWords(text, i, 16, space_mask, word_begin, words);
+        }
+#endif
+
+        // Scalar fallback for the rest of the text
+        for (; i < text.size(); i += CHUNK_SIZE) {
+            const size_t chunk_size = std::min(CHUNK_SIZE, text.size() - i);
+            uint32_t space_mask = 0;
+            for (size_t j = 0; j < chunk_size; ++j) {
+                if (Validate && IsControlCharacter(text[i + j])) {
+                    return false;
+                }
+                space_mask |= static_cast<uint32_t>(text[i + j] == ' ') << j;
+            }
+            CollectWords(text, i, chunk_size, space_mask, word_begin, words);
+        }
+
+        if (word_begin != std::string_view::npos) {
+            words.push_back(text.substr(word_begin));
+        }
+        return true;
+    }
+}
 
 std::vector<std::string> SplitIntoWords(const std::string &text) {
     std::vector<std::string> words;
@@ -25,20 +134,36 @@ std::vector<std::string> SplitIntoWords(const std::string &text) {
 
 std::vector<std::string_view> SplitIntoWordsStrView(std::string_view text){
     std::vector<std::string_view> words;
-    std::string_view word;
-
-    text.remove_prefix(std::min(text.size(), text.find_first_not_of(' ')));
-
-    while (!text.empty()) {
-        text.remove_prefix(std::min(text.size(), text.find_first_not_of(' ')));
-        if (text.empty()) break; // ?
-        auto x = text.find(' ');
-        words.push_back(text.substr(0, x));
-        text.remove_prefix(std::min(text.size(), x));
-    }
-
+    SplitIntoWordsImpl<false>(text, words);
     return words;
 }
 
+bool SplitIntoValidWords(std::string_view text, std::vector<std::string_view> &words) {
+    return SplitIntoWordsImpl<true>(text, words);
+}
 
-
+bool MatchesWildcard(std::string_view text, std::string_view pattern) {
+    // Greedy matching that backtracks only to the last star: it stretches by one character per retry
+    size_t text_position = 0;
+    size_t pattern_position = 0;
+    size_t star = std::string_view::npos;
+    size_t star_text_position = 0;
+    while (text_position < text.size()) {
+        if (pattern_position < pattern.size() && pattern[pattern_position] == '*') {
+            star = pattern_position++;
+            star_text_position = text_position;
+        } else if (pattern_position < pattern.size() && pattern[pattern_position] == text[text_position]) {
+            ++pattern_position;
+            ++text_position;
+        } else if (star != std::string_view::npos) {
+            pattern_position = star + 1;
+            text_position = ++star_text_position;
+        } else {
+            return false;
+        }
+    }
+    while (pattern_position < pattern.size() && pattern[pattern_position] == '*') {
+        ++pattern_position;
+    }
+    return pattern_position == pattern.size();
+}
@@ -1,5 +1,6 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <vector>
 #include <iostream>
 #include <set>
@@ -8,6 +9,13 @@ std::vector<std::string> SplitIntoWords(const std::string &text);
 
 std::vector<std::string_view> SplitIntoWordsStrView(std::string_view text);
 
+// Splits text by spaces into the reusable words buffer and checks it for control characters (codes 0 to 31)
+// in the same pass. Returns false on a control character, leaving the buffer content unspecified.
+bool SplitIntoValidWords(std::string_view text, std::vector<std::string_view> &words);
+
+// Checks the text against a pattern in which every * stands for any, possibly empty, sequence of characters
+bool MatchesWildcard(std::string_view text, std::string_view pattern);
+
 template<typename StringContainer>
 std::set<std::string, std::less<>> MakeUniqueNonEmptyStrings(const StringContainer &strings) {
     std::set<std::string, std::less<>> non_empty_strings;
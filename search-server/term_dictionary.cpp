@@ -0,0 +1,115 @@
+#include "term_dictionary.h"
+#include <algorithm>
+
+namespace {
+    const size_t INITIAL_SLOT_COUNT = 1024;
+}
+
+TermDictionary::TermDictionary() {
+    term_offsets_.Mutable().push_back(0);
+    slots_.Mutable().assign(INITIAL_SLOT_COUNT, NO_TERM);
+}
+
+uint32_t TermDictionary::Find(std::string_view term) const {
+    return slots_[FindSlot(term)];
+}
+
+uint32_t TermDictionary::Intern(std::string_view term) {
+    size_t slot = FindSlot(term);
+    if (slots_[slot] != NO_TERM) {
+        return slots_[slot];
+    }
+
+    const auto term_id = static_cast<uint32_t>(size());
+    auto &term_data = term_data_.Mutable();
+    term_data.insert(term_data.end(), term.begin(), term.end());
+    term_offsets_.Mutable().push_back(static_cast<uint32_t>(term_data.size()));
+    slots_.Mutable()[slot] = term_id;
+
+    // Keep the load factor under 1/2 so that probe sequences stay short
+    if (size() * 2 > slots_.size()) {
+        Rehash(slots_.size() * 2);
+    }
+    return term_id;
+}
+
+std::string_view TermDictionary::GetTerm(uint32_t term_id) const {
+    const uint32_t begin = term_offsets_[term_id];
+    return {term_data_.data() + begin, term_offsets_[term_id + 1] - begin};
+}
+
+size_t TermDictionary::size() const {
+    return term_offsets_.size() - 1;
+}
+
+uint64_t TermDictionary::Hash(std::string_view term) {
+    // FNV-1a, stable across builds and platforms
+    uint64_t hash = 14695981039346656037ULL;
+    for (const char c: term) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+size_t TermDictionary::FindSlot(std::string_view term) const {
+    const size_t mask = slots_.size() - 1;
+    for (size_t slot = Hash(term) & mask;; slot = (slot + 1) & mask) {
+        if (slots_[slot] == NO_TERM || GetTerm(slots_[slot]) == term) {
+            return slot;
+        }
+    }
+}
+
+void TermDictionary::Rehash(size_t slot_count) {
+    auto &slots = slots_.Mutable();
+    slots.assign(slot_count, NO_TERM);
+    const size_t mask = slot_count - 1;
+    for (uint32_t term_id = 0; term_id < size(); ++term_id) {
+        size_t slot = Hash(GetTerm(term_id)) & mask;
+        while (slots[slot] != NO_TERM) {
+            slot = (slot + 1) & mask;
+        }
+        slots[slot] = term_id;
+    }
+}
+
+void TermDictionary::Save(SnapshotWriter &writer) const {
+    writer.WriteArray(term_data_.data(), term_data_.size());
+    writer.WriteArray(term_offsets_.data(), term_offsets_.size());
+    writer.WriteArray(slots_.data(), slots_.size());
+}
+
+TermDictionary TermDictionary::Load(SnapshotReader &reader) {
+    TermDictionary dictionary;
+    dictionary.term_data_ = reader.ReadArray<char>();
+    dictionary.term_offsets_ = reader.ReadArray<uint32_t>();
+    dictionary.slots_ = reader.ReadArray<uint32_t>();
+
+    const size_t slot_count = dictionary.slots_.size();
+    if (dictionary.term_offsets_.empty() || dictionary.term_offsets_.back() != dictionary.term_data_.size() ||
+        slot_count < dictionary.size() * 2 || (slot_count & (slot_count - 1)) != 0) {
+        SnapshotReader::ThrowCorrupted();
+    }
+    // Lookups trust the offsets and slots: a decreasing offset or a foreign id would read outside the term data,
+    // and a table without empty slots would make probing endless
+    if (dictionary.term_offsets_[0] != 0 ||
+        !std::is_sorted(dictionary.term_offsets_.begin(), dictionary.term_offsets_.end())) {
+        SnapshotReader::ThrowCorrupted();
+    }
+    std::vector<bool> is_slotted(dictionary.size());
+    size_t empty_slot_count = 0;
+    for (const uint32_t term_id: dictionary.slots_) {
+        if (term_id == NO_TERM) {
+            ++empty_slot_count;
+        } else if (term_id >= dictionary.size() || is_slotted[term_id]) {
+            SnapshotReader::ThrowCorrupted();
+        } else {
+            is_slotted[term_id] = true;
+        }
+    }
+    if (empty_slot_count == 0 || slot_count - empty_slot_count != dictionary.size()) {
+        SnapshotReader::ThrowCorrupted();
+    }
+    return dictionary;
+}
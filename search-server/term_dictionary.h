@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "mapped_array.h"
+#include "snapshot.h"
+
+// Interns index terms into dense 32-bit ids. Term bytes live in one contiguous buffer and lookups go
+// through an open-addressing hash table of ids, so the whole dictionary is position independent.
+class TermDictionary {
+public:
+    static constexpr uint32_t NO_TERM = UINT32_MAX;
+
+    TermDictionary();
+
+    // Returns the id of the term or NO_TERM if the term is unknown
+    [[nodiscard]] uint32_t Find(std::string_view term) const;
+
+    // Returns the id of the term, adding it to the dictionary if needed
+    uint32_t Intern(std::string_view term);
+
+    // The view is invalidated by the next call to Intern
+    [[nodiscard]] std::string_view GetTerm(uint32_t term_id) const;
+
+    [[nodiscard]] size_t size() const;
+
+    void Save(SnapshotWriter &writer) const;
+
+    // The dictionary refers to the mapped snapshot until it is modified
+    static TermDictionary Load(SnapshotReader &reader);
+
+private:
+    MappedArray<char> term_data_;
+    MappedArray<uint32_t> term_offsets_;
+    MappedArray<uint32_t> slots_;
+
+    static uint64_t Hash(std::string_view term);
+
+    [[nodiscard]] size_t FindSlot(std::string_view term) const;
+
+    void Rehash(size_t slot_count);
+};
@@ -0,0 +1,61 @@
+#include "term_index.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    // Smaller runs are merged regardless of the size of the main one
+    const size_t MIN_RECENT_RUN_SIZE = 256;
+}
+
+void TermIndex::Add(const TermDictionary &dictionary, uint32_t term_id) {
+    const auto by_term = [&dictionary](uint32_t lhs, uint32_t rhs) {
+        return dictionary.GetTerm(lhs) < dictionary.GetTerm(rhs);
+    };
+    recent_ids_.insert(std::upper_bound(recent_ids_.begin(), recent_ids_.end(), term_id, by_term), term_id);
+    const auto max_recent_size = static_cast<size_t>(std::sqrt(static_cast<double>(sorted_ids_.size())));
+    if (recent_ids_.size() <= std::max(MIN_RECENT_RUN_SIZE, max_recent_size)) {
+        return;
+    }
+    std::vector<uint32_t> merged(sorted_ids_.size() + recent_ids_.size());
+    std::merge(sorted_ids_.begin(), sorted_ids_.end(), recent_ids_.begin(), recent_ids_.end(), merged.begin(), by_term);
+    sorted_ids_.Mutable() = std::move(merged);
+    recent_ids_.clear();
+}
+
+void TermIndex::Remap(const std::vector<uint32_t> &new_term_ids) {
+    const auto remap = [&new_term_ids](std::vector<uint32_t> &term_ids) {
+        auto end = std::remove_if(term_ids.begin(), term_ids.end(), [&new_term_ids](uint32_t term_id) {
+            return new_term_ids[term_id] == TermDictionary::NO_TERM;
+        });
+        term_ids.erase(end, term_ids.end());
+        for (auto &term_id: term_ids) {
+            term_id = new_term_ids[term_id];
+        }
+    };
+    remap(sorted_ids_.Mutable());
+    remap(recent_ids_);
+}
+
+void TermIndex::Save(const TermDictionary &dictionary, SnapshotWriter &writer) const {
+    std::vector<uint32_t> merged(sorted_ids_.size() + recent_ids_.size());
+    std::merge(sorted_ids_.begin(), sorted_ids_.end(), recent_ids_.begin(), recent_ids_.end(), merged.begin(),
+               [&dictionary](uint32_t lhs, uint32_t rhs) {
+                   return dictionary.GetTerm(lhs) < dictionary.GetTerm(rhs);
+               });
+    writer.WriteArray(merged.data(), merged.size());
+}
+
+TermIndex TermIndex::Load(const TermDictionary &dictionary, SnapshotReader &reader) {
+    TermIndex index;
+    index.sorted_ids_ = reader.ReadArray<uint32_t>();
+    // A damaged order only spoils lookups, ids out of range would read outside the dictionary
+    if (index.sorted_ids_.size() != dictionary.size()) {
+        SnapshotReader::ThrowCorrupted();
+    }
+    for (const uint32_t term_id: index.sorted_ids_) {
+        if (term_id >= dictionary.size()) {
+            SnapshotReader::ThrowCorrupted();
+        }
+    }
+    return index;
+}
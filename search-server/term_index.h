@@ -0,0 +1,92 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "mapped_array.h"
+#include "snapshot.h"
+#include "string_processing.h"
+#include "term_dictionary.h"
+
+// Ids of the terms of a dictionary in the lexicographic order of the terms, for prefix lookups. The index holds
+// only ids and compares the term bytes of the dictionary, which every call is given. New terms go to a small
+// sorted run that is merged into the main one once it outgrows the square root of the main run, so adding a term
+// costs amortized O(sqrt(n)) and lookups never sort.
+class TermIndex {
+public:
+    // term_id is a term just added to the dictionary
+    void Add(const TermDictionary &dictionary, uint32_t term_id);
+
+    // Calls function(term_id) for every term starting with the prefix, in no particular order
+    template<typename Function>
+    void ForEachWithPrefix(const TermDictionary &dictionary, std::string_view prefix, Function function) const;
+
+    // Appends the terms matching the wildcard pattern that have a positive document_freq(term_id), keeping
+    // the max_term_count most frequent ones. Ties go to the lexicographically smaller terms, so dictionaries
+    // holding different parts of a collection agree when given the same frequencies.
+    template<typename DocumentFreq>
+    void ExpandWildcard(const TermDictionary &dictionary, std::string_view pattern, size_t max_term_count,
+                        DocumentFreq document_freq, std::vector<std::string_view> &words) const;
+
+    // Renumbers the terms after the dictionary was rebuilt without some of them, keeping their order:
+    // new_term_ids maps old ids to new ones or to TermDictionary::NO_TERM
+    void Remap(const std::vector<uint32_t> &new_term_ids);
+
+    void Save(const TermDictionary &dictionary, SnapshotWriter &writer) const;
+
+    // The index refers to the mapped snapshot until it is modified. Throws runtime_error if it does not index
+    // every term of the dictionary.
+    static TermIndex Load(const TermDictionary &dictionary, SnapshotReader &reader);
+
+private:
+    MappedArray<uint32_t> sorted_ids_;
+    std::vector<uint32_t> recent_ids_;
+
+    template<typename Function>
+    static void ForEachWithPrefix(const TermDictionary &dictionary, const uint32_t *begin, const uint32_t *end,
+                                  std::string_view prefix, Function function);
+};
+
+template<typename Function>
+void TermIndex::ForEachWithPrefix(const TermDictionary &dictionary, std::string_view prefix,
+                                  Function function) const {
+    ForEachWithPrefix(dictionary, sorted_ids_.begin(), sorted_ids_.end(), prefix, function);
+    ForEachWithPrefix(dictionary, recent_ids_.data(), recent_ids_.data() + recent_ids_.size(), prefix, function);
+}
+
+template<typename DocumentFreq>
+void TermIndex::ExpandWildcard(const TermDictionary &dictionary, std::string_view pattern, size_t max_term_count,
+                               DocumentFreq document_freq, std::vector<std::string_view> &words) const {
+    std::vector<std::pair<size_t, std::string_view>> matches;
+    ForEachWithPrefix(dictionary, pattern.substr(0, pattern.find('*')), [&](uint32_t term_id) {
+        const size_t term_document_freq = document_freq(term_id);
+        const std::string_view term = dictionary.GetTerm(term_id);
+        if (term_document_freq > 0 && MatchesWildcard(term, pattern)) {
+            matches.emplace_back(term_document_freq, term);
+        }
+    });
+    if (matches.size() > max_term_count) {
+        const auto more_frequent = [](const std::pair<size_t, std::string_view> &lhs,
+                                      const std::pair<size_t, std::string_view> &rhs) {
+            return lhs.first > rhs.first || (lhs.first == rhs.first && lhs.second < rhs.second);
+        };
+        std::nth_element(matches.begin(), matches.begin() + max_term_count, matches.end(), more_frequent);
+        matches.resize(max_term_count);
+    }
+    for (const auto &[term_document_freq, term]: matches) {
+        words.push_back(term);
+    }
+}
+
+template<typename Function>
+void TermIndex::ForEachWithPrefix(const TermDictionary &dictionary, const uint32_t *begin, const uint32_t *end,
+                                  std::string_view prefix, Function function) {
+    const uint32_t *term_id = std::lower_bound(begin, end, prefix, [&dictionary](uint32_t id, std::string_view term) {
+        return dictionary.GetTerm(id) < term;
+    });
+    for (; term_id != end && dictionary.GetTerm(*term_id).substr(0, prefix.size()) == prefix; ++term_id) {
+        function(*term_id);
+    }
+}
@@ -1,4 +1,54 @@
 #include "test_example_functions.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include "concurrent_search_server.h"
+#include "request_queue.h"
+
+using namespace std::string_literals;
+
+namespace {
+    void Check(bool condition, const std::string &message) {
+        if (!condition) {
+            throw std::logic_error(message);
+        }
+    }
+
+    // Lower word numbers are more frequent, so their posting lists span many blocks
+    std::string GenerateText(std::mt19937 &generator, int dictionary_size, int max_word_count, double minus_prob = 0) {
+        std::uniform_int_distribution<int> word(0, dictionary_size - 1);
+        std::string text;
+        const int word_count = std::uniform_int_distribution<int>(1, max_word_count)(generator);
+        for (int i = 0; i < word_count; ++i) {
+            if (!text.empty()) {
+                text.push_back(' ');
+            }
+            if (std::uniform_real_distribution<>(0, 1)(generator) < minus_prob) {
+                text.push_back('-');
+            }
+            text += "w"s + std::to_string(std::min(word(generator), word(generator)));
+        }
+        return text;
+    }
+
+    template<typename Scorer>
+    void CheckBlockMaxWand(const SearchServer &search_server, const std::string &raw_query, DocumentStatus status,
+                           size_t result_limit) {
+        const auto expected = search_server.FindTopDocuments<Scorer>(std::execution::seq, raw_query, status,
+                                                                     result_limit);
+        const auto found = search_server.FindTopDocuments<Scorer>(search_policy::block_max_wand, raw_query, status,
+                                                                  result_limit);
+        Check(found.size() == expected.size(), "Block-max WAND found another number of documents for "s + raw_query);
+        for (size_t i = 0; i < found.size(); ++i) {
+            Check(std::abs(found[i].relevance - expected[i].relevance) < 1e-9 && found[i].rating == expected[i].rating,
+                  "Block-max WAND ranked other documents for "s + raw_query);
+        }
+    }
+}
 
 void AddDocument(SearchServer &searchServer, int document_id, const std::string &document, DocumentStatus status,
                  const std::vector<int> &ratings) {
@@ -9,3 +59,94 @@ void RemoveDocument(SearchServer& searchServer, int document_id){
     searchServer.RemoveDocument(document_id);
 }
 
+
+void TestBlockMaxWandMatchesExhaustive() {
+    std::mt19937 generator(42);
+    SearchServer search_server("w3"s);
+    for (int document_id = 0; document_id < 1000; ++document_id) {
+        search_server.AddDocument(document_id, GenerateText(generator, 60, 30),
+                                  document_id % 5 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL,
+                                  {document_id % 7, document_id % 3});
+    }
+    for (int document_id = 0; document_id < 1000; document_id += 9) {
+        search_server.RemoveDocument(document_id);
+    }
+    for (int i = 0; i < 100; ++i) {
+        const std::string raw_query = GenerateText(generator, 60, 4, 0.2);
+        for (const size_t result_limit: {size_t{1}, size_t{3}, size_t{MAX_RESULT_DOCUMENT_COUNT}}) {
+            for (const DocumentStatus status: {DocumentStatus::ACTUAL, DocumentStatus::BANNED}) {
+                CheckBlockMaxWand<scoring::TfIdf>(search_server, raw_query, status, result_limit);
+                CheckBlockMaxWand<scoring::Bm25>(search_server, raw_query, status, result_limit);
+                CheckBlockMaxWand<scoring::Bm25Plus>(search_server, raw_query, status, result_limit);
+            }
+        }
+    }
+}
+
+void TestConcurrentSearchServer() {
+    ConcurrentSearchServer search_server("and"s);
+    for (int document_id = 0; document_id < 100; ++document_id) {
+        search_server.AddDocument(document_id, "curly cat"s, DocumentStatus::ACTUAL, {1});
+    }
+    std::atomic<bool> is_writing = true;
+    std::atomic<bool> is_consistent = true;
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 4; ++i) {
+        readers.emplace_back([&] {
+            // The words a wildcard matched must outlive the writes that follow
+            const auto [words, status] = search_server.MatchDocument("cur*"s, 0);
+            while (is_writing) {
+                const int document_count = search_server.GetDocumentCount();
+                const auto documents = search_server.FindTopDocuments("cat"s);
+                if (document_count < 100 || document_count > 200 || documents.size() != MAX_RESULT_DOCUMENT_COUNT) {
+                    is_consistent = false;
+                }
+            }
+            if (words.size() != 1 || words[0] != "curly"s || status != DocumentStatus::ACTUAL) {
+                is_consistent = false;
+            }
+        });
+    }
+    // Every tenth document removes two earlier ones, so 80 of the 100 added documents stay
+    for (int document_id = 100; document_id < 200; ++document_id) {
+        search_server.AddDocument(document_id, "cat number"s + std::to_string(document_id), DocumentStatus::ACTUAL,
+                                  {2});
+        if (document_id % 10 == 9) {
+            search_server.RemoveDocuments({document_id - 1, document_id - 3});
+        }
+    }
+    is_writing = false;
+    for (auto &reader: readers) {
+        reader.join();
+    }
+    Check(is_consistent, "A reader saw a partly modified index"s);
+    Check(search_server.GetDocumentCount() == 180, "Concurrent writes lost documents"s);
+    Check(search_server.FindTopDocuments("number150"s).size() == 1 &&
+          search_server.FindTopDocuments("number158"s).empty(), "Concurrent writes went to one copy only"s);
+}
+
+void TestRequestQueueConcurrency() {
+    SearchServer search_server("and"s);
+    search_server.AddDocument(1, "curly cat"s, DocumentStatus::ACTUAL, {1});
+    RequestQueue request_queue(search_server);
+    std::atomic<bool> is_consistent = true;
+    std::vector<std::thread> threads;
+    // Half of the threads ask for a word no document has
+    for (int i = 0; i < 6; ++i) {
+        threads.emplace_back([&, i] {
+            for (int request = 0; request < 1000; ++request) {
+                (void) request_queue.AddFindRequest(i % 2 == 0 ? "cat"s : "dog"s);
+                const int no_result_count = request_queue.GetNoResultRequests();
+                if (no_result_count < 0 || no_result_count > request_queue.GetRequestCount()) {
+                    is_consistent = false;
+                }
+            }
+        });
+    }
+    for (auto &thread: threads) {
+        thread.join();
+    }
+    Check(is_consistent, "Request counts went out of range while recording"s);
+    Check(request_queue.GetRequestCount() == 6000 && request_queue.GetNoResultRequests() == 3000,
+          "Requests recorded from several threads were miscounted"s);
+}
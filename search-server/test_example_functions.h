@@ -7,3 +7,14 @@ void AddDocument(SearchServer &searchServer, int document_id, const std::string
 
 void RemoveDocument(SearchServer& searchServer, int document_id);
 
+// Checks that FindTopDocuments with block-max WAND returns the same documents as scoring every posting, for every
+// relevance model. Throws logic_error on a mismatch
+void TestBlockMaxWandMatchesExhaustive();
+
+// Queries a ConcurrentSearchServer from several threads while documents are added and removed.
+// Throws logic_error if a reader sees an inconsistent index
+void TestConcurrentSearchServer();
+
+// Records requests into a RequestQueue from several threads. Throws logic_error if a request is miscounted
+void TestRequestQueueConcurrency();
+
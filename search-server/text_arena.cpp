@@ -0,0 +1,24 @@
+#include "text_arena.h"
+#include <algorithm>
+
+std::string_view TextArena::Append(std::string_view text) {
+    if (text.empty()) {
+        return {};
+    }
+    size_ += text.size();
+    if (text.size() > CHUNK_SIZE / 4) {
+        // A large text gets a chunk of its own and leaves the free space of the current one for others
+        auto &chunk = chunks_.emplace_back(new char[text.size()]);
+        std::copy(text.begin(), text.end(), chunk.get());
+        return {chunk.get(), text.size()};
+    }
+    if (text.size() > free_size_) {
+        free_begin_ = chunks_.emplace_back(new char[CHUNK_SIZE]).get();
+        free_size_ = CHUNK_SIZE;
+    }
+    const std::string_view stored(free_begin_, text.size());
+    std::copy(text.begin(), text.end(), free_begin_);
+    free_begin_ += text.size();
+    free_size_ -= text.size();
+    return stored;
+}
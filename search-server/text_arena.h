@@ -0,0 +1,46 @@
+#pragma once
+
+#include <memory>
+#include <string_view>
+#include <vector>
+
+// Append-only storage of texts in large chunks, so storing a document costs no allocation of its own.
+// Released texts only count as dead bytes; the owner compacts by copying the live texts into a new arena.
+class TextArena {
+public:
+    static constexpr size_t CHUNK_SIZE = 1 << 20;
+
+    TextArena() = default;
+
+    // Views into the arena stay valid while it is moved around
+    TextArena(TextArena &&) = default;
+
+    TextArena &operator=(TextArena &&) = default;
+
+    // Returns the stored copy of the text, valid until the arena is destroyed
+    std::string_view Append(std::string_view text);
+
+    void Release(std::string_view text) {
+        dead_size_ += text.size();
+    }
+
+    [[nodiscard]] size_t GetLiveSize() const {
+        return size_ - dead_size_;
+    }
+
+    [[nodiscard]] size_t GetDeadSize() const {
+        return dead_size_;
+    }
+
+    // Compaction pays off once the dead texts outweigh the live ones and take at least a chunk
+    [[nodiscard]] bool NeedsCompaction() const {
+        return dead_size_ > GetLiveSize() && dead_size_ >= CHUNK_SIZE;
+    }
+
+private:
+    std::vector<std::unique_ptr<char[]>> chunks_;
+    char *free_begin_ = nullptr;
+    size_t free_size_ = 0;
+    size_t size_ = 0;
+    size_t dead_size_ = 0;
+};
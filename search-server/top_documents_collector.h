@@ -0,0 +1,67 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include "document.h"
+
+constexpr float EPSILON = 1e-6;
+
+// Result order of FindTopDocuments: by relevance, documents with equal relevance by rating, then by id, so that
+// every execution path returns ties in the same order
+inline bool IsBetterDocument(const Document &lhs, const Document &rhs) {
+    if (std::abs(lhs.relevance - rhs.relevance) < EPSILON) {
+        if (lhs.rating != rhs.rating) {
+            return lhs.rating > rhs.rating;
+        }
+        return lhs.id < rhs.id;
+    }
+    return lhs.relevance > rhs.relevance;
+}
+
+// Bounded heap that keeps the best `limit` documents out of any number of candidates
+class TopDocumentsCollector {
+public:
+    explicit TopDocumentsCollector(size_t limit)
+            : limit_(limit) {
+        documents_.reserve(limit);
+    }
+
+    void Add(const Document &document) {
+        if (documents_.size() < limit_) {
+            documents_.push_back(document);
+            std::push_heap(documents_.begin(), documents_.end(), IsBetterDocument);
+        } else if (limit_ > 0 && IsBetterDocument(document, documents_.front())) {
+            std::pop_heap(documents_.begin(), documents_.end(), IsBetterDocument);
+            documents_.back() = document;
+            std::push_heap(documents_.begin(), documents_.end(), IsBetterDocument);
+        }
+    }
+
+    [[nodiscard]] size_t GetLimit() const {
+        return limit_;
+    }
+
+    // Relevance a new document has to exceed to have a chance of being collected
+    [[nodiscard]] double GetAdmissionThreshold() const {
+        if (documents_.size() < limit_) {
+            return -std::numeric_limits<double>::infinity();
+        }
+        if (limit_ == 0) {
+            return std::numeric_limits<double>::infinity();
+        }
+        return documents_.front().relevance - EPSILON;
+    }
+
+    // Returns the collected documents in result order and leaves the collector empty
+    std::vector<Document> Extract() {
+        std::sort_heap(documents_.begin(), documents_.end(), IsBetterDocument);
+        return std::move(documents_);
+    }
+
+private:
+    size_t limit_;
+    // The worst of the collected documents is on top of the heap
+    std::vector<Document> documents_;
+};